@@ -0,0 +1,356 @@
+/* bcache.c
+ * Buffer cache, see bcache.h
+ *
+ * NOTE
+ * The cache is changed with interrupts disabled, since processes are
+ * preempted by the tick; a block is read from the device with them enabled.
+ * A buffer being read is already in the hash table, so that the block is
+ * read only once; others who find it wait until it is up to date.
+*/
+
+#include "bcache.h"
+#include "memory.h"
+#include "interrupt.h"
+#include "proc.h"
+#include "string.h"
+#include "initcall.h"
+
+#define NULL ((void *)0)
+
+
+#define bcache_hashfn(sd,blocknr) \
+	((((unsigned int)(sd)>>4) ^ (blocknr)) & (BCACHE_HASH_SIZE-1))
+
+static struct list_head bcache_hash[BCACHE_HASH_SIZE];
+static struct list_head bcache_lru;
+static struct bcache_stats bstats;
+
+/* Initialize the buffer cache */
+int __init bcache_init(void)
+{
+	int i;
+
+	for(i=0; i<BCACHE_HASH_SIZE; i++) {
+		INIT_LIST_HEAD(&bcache_hash[i]);
+	}
+	INIT_LIST_HEAD(&bcache_lru);
+	bstats.budget = BCACHE_DEFAULT_BUDGET;
+
+	return 0;
+}
+subsys_initcall(bcache_init);
+
+static void bh_free(struct buffer_head *bh)
+{
+	list_del(&bh->hash);
+	list_del(&bh->lru);
+	bstats.nr_buffers--;
+	bstats.size -= bh->size;
+
+	kfree(bh->data);
+	kfree(bh);
+}
+
+/* Evict unused buffers, the least recently used first, until "size" more
+ * bytes fit in the budget; called with interrupts disabled
+ *
+ * Return value: 0 if they fit, -1 otherwise
+ */
+static int bcache_shrink(size_t size)
+{
+	struct list_head *pos, *n;
+	struct buffer_head *bh;
+
+	list_for_each_safe(pos, n, &bcache_lru) {
+		if(bstats.size + size <= bstats.budget) {
+			break;
+		}
+
+		bh = list_entry(pos, struct buffer_head, lru);
+		if(bh->count == 0) {
+			bh_free(bh);
+			bstats.evictions++;
+		}
+	}
+
+	return bstats.size + size <= bstats.budget ? 0 : -1;
+}
+
+/* Set the memory budget of the cache to "bytes" of block data */
+void bcache_set_budget(unsigned int bytes)
+{
+	unsigned int flags;
+
+	flags = local_irq_save();
+	bstats.budget = bytes;
+	bcache_shrink(0);
+	local_irq_restore(flags);
+}
+
+static struct buffer_head *bcache_lookup(struct storage_device *sd, unsigned int blocknr)
+{
+	struct list_head *pos;
+	struct buffer_head *bh;
+
+	list_for_each(pos, &bcache_hash[bcache_hashfn(sd, blocknr)]) {
+		bh = list_entry(pos, struct buffer_head, hash);
+		if(bh->sd == sd && bh->blocknr == blocknr) {
+			return bh;
+		}
+	}
+
+	return NULL;
+}
+
+/* Allocate a held buffer for block "blocknr" of device "sd" */
+static struct buffer_head *bh_alloc(struct storage_device *sd, unsigned int blocknr)
+{
+	struct buffer_head *bh;
+
+	if((bh = (struct buffer_head *)kmalloc(sizeof(struct buffer_head))) == NULL) {
+		return NULL;
+	}
+	if((bh->data = (char *)kmalloc(sd->sector_size)) == NULL) {
+		kfree(bh);
+		return NULL;
+	}
+	bh->sd = sd;
+	bh->blocknr = blocknr;
+	bh->size = sd->sector_size;
+	bh->state = 0;
+	bh->count = 1;
+
+	return bh;
+}
+
+/* Put a new buffer into the cache; called with interrupts disabled
+ *
+ * Return value: 0 on success; -1 if the block has been cached meanwhile, or 
+ *  "must_fit" is set and the buffer does not fit in the budget
+ */
+static int bh_insert(struct buffer_head *bh, int must_fit)
+{
+	if(bcache_lookup(bh->sd, bh->blocknr)) {
+		return -1;
+	}
+	if(bcache_shrink(bh->size) && must_fit) {
+		return -1;
+	}
+
+	list_add(&bh->hash, &bcache_hash[bcache_hashfn(bh->sd, bh->blocknr)]);
+	list_add_tail(&bh->lru, &bcache_lru);
+	bstats.nr_buffers++;
+	bstats.size += bh->size;
+
+	return 0;
+}
+
+/* Get block "blocknr" of device "sd", reading it if it is not cached
+ *
+ * NOTE
+ * When all cached blocks are held, the budget may be exceeded for a while.
+ *
+ * Return value: the held buffer, or NULL on error
+ */
+struct buffer_head *bread(struct storage_device *sd, unsigned int blocknr)
+{
+	struct buffer_head *bh;
+	unsigned int flags;
+
+AGAIN:
+	flags = local_irq_save();
+
+	if((bh = bcache_lookup(sd, blocknr))) {
+		bh->count++;
+		list_del(&bh->lru);
+		list_add_tail(&bh->lru, &bcache_lru);
+		bstats.hits++;
+		local_irq_restore(flags);
+
+		/// Being read by someone else, or read ahead
+		while(!(bh->state & (BH_UPTODATE|BH_ERROR))) {
+			schedule();
+		}
+		if(bh->state & BH_ERROR) {
+			brelse(bh);
+			return NULL;
+		}
+
+		return bh;
+	}
+
+	local_irq_restore(flags);
+
+	if((bh = bh_alloc(sd, blocknr)) == NULL) {
+		return NULL;
+	}
+
+	flags = local_irq_save();
+	/// Someone else has cached the block meanwhile
+	if(bh_insert(bh, 0)) {
+		local_irq_restore(flags);
+		kfree(bh->data);
+		kfree(bh);
+		goto AGAIN;
+	}
+	bstats.misses++;
+	local_irq_restore(flags);
+
+	if(sd->dout(sd, bh->data, blocknr*bh->size, bh->size)) {
+		// Waiters see the error; the last holder frees the buffer
+		bh->state = BH_ERROR;
+		brelse(bh);
+		return NULL;
+	}
+	bh->state = BH_UPTODATE;
+
+	return bh;
+}
+
+/* Completion of a block read ahead; drops the hold taken by readahead */
+static void bh_end_io(struct bio *bio, int error)
+{
+	struct buffer_head *bh = (struct buffer_head *)bio->private;
+
+	bh->state = error ? BH_ERROR : BH_UPTODATE;
+	brelse(bh);
+}
+
+/* Start reading the blocks of device "sd" that hold "size" bytes at offset
+ * "pos" into the cache, without waiting for them
+ *
+ * NOTE
+ * 1. Blocks already cached are skipped. Each missing block is submitted as
+ *    a bio while the queue is plugged, so that adjacent blocks reach the 
+ *    driver as a few large requests.
+ * 2. A buffer is held until its bio completes, so it cannot be evicted while
+ *    being read; bread() of it waits as for any block being read.
+ * 3. Readahead stops rather than push the cache over its budget.
+ *
+ * Return value: # of blocks submitted
+ */
+int bcache_readahead(struct storage_device *sd, unsigned int pos, size_t size)
+{
+	struct buffer_head *bh;
+	unsigned int blocknr, last, flags;
+	int n = 0;
+
+	if(sd->queue == NULL || size == 0 || pos >= sd->storage_size) {
+		return 0;
+	}
+	if(size > sd->storage_size - pos) {
+		size = sd->storage_size - pos;
+	}
+	blocknr = pos / sd->sector_size;
+	last = (pos + size - 1) / sd->sector_size;
+
+	blk_plug(sd->queue);
+	for(; blocknr <= last; blocknr++) {
+		flags = local_irq_save();
+		bh = bcache_lookup(sd, blocknr);
+		local_irq_restore(flags);
+		if(bh) {
+			continue;
+		}
+
+		if((bh = bh_alloc(sd, blocknr)) == NULL) {
+			break;
+		}
+		flags = local_irq_save();
+		if(bh_insert(bh, 1)) {
+			local_irq_restore(flags);
+			kfree(bh->data);
+			kfree(bh);
+			if(bcache_lookup(sd, blocknr)) {
+				continue;
+			}
+			break;
+		}
+		bstats.readaheads++;
+		local_irq_restore(flags);
+
+		bh->vec.buf = bh->data;
+		bh->vec.len = bh->size;
+		bh->bio.dir = READ;
+		bh->bio.pos = blocknr * bh->size;
+		bh->bio.vecs = &bh->vec;
+		bh->bio.nr_vecs = 1;
+		bh->bio.end_io = bh_end_io;
+		bh->bio.private = bh;
+		if(submit_bio(sd->queue, &bh->bio)) {
+			bh->state = BH_ERROR;
+			brelse(bh);
+			break;
+		}
+		n++;
+	}
+	blk_unplug(sd->queue);
+
+	return n;
+}
+
+/* Give back a buffer got by bread() */
+void brelse(struct buffer_head *bh)
+{
+	unsigned int flags;
+
+	flags = local_irq_save();
+	if(--bh->count == 0 && (bh->state & BH_ERROR)) {
+		bh_free(bh);
+	}
+	local_irq_restore(flags);
+}
+
+/* Copy "size" bytes at offset "pos" of device "sd" into "dest" through the
+ * cache
+ *
+ * Return value: 0 on success, -1 on error
+ */
+int bcache_read(struct storage_device *sd, void *dest, unsigned int pos, size_t size)
+{
+	struct buffer_head *bh;
+	unsigned int blocknr, offset, n;
+	char *p = (char *)dest;
+
+	while(size > 0) {
+		blocknr = pos / sd->sector_size;
+		offset = pos % sd->sector_size;
+		n = sd->sector_size - offset;
+		if(n > size) { n = size; }
+
+		if((bh = bread(sd, blocknr)) == NULL) {
+			return -1;
+		}
+		memcpy(p, bh->data + offset, n);
+		brelse(bh);
+
+		p += n;
+		pos += n;
+		size -= n;
+	}
+
+	return 0;
+}
+
+/* Drop all unused cached blocks of device "sd" */
+void bcache_invalidate(struct storage_device *sd)
+{
+	struct list_head *pos, *n;
+	struct buffer_head *bh;
+	unsigned int flags;
+
+	flags = local_irq_save();
+	list_for_each_safe(pos, n, &bcache_lru) {
+		bh = list_entry(pos, struct buffer_head, lru);
+		if(bh->sd == sd && bh->count == 0) {
+			bh_free(bh);
+		}
+	}
+	local_irq_restore(flags);
+}
+
+/* Get the statistics of the cache */
+void bcache_get_stats(struct bcache_stats *stats)
+{
+	*stats = bstats;
+}
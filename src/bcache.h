@@ -0,0 +1,68 @@
+/* bcache.h
+ * Buffer cache of device blocks, shared by all file systems
+ *
+ * NOTE
+ * 1. A block is "sector_size" bytes of a storage device. Cached blocks are
+ *    found by (device, block #) through a hash table, and kept in LRU order;
+ *    when the cache is over its memory budget, the least recently used block
+ *    that nobody holds is evicted.
+ * 2. bread() returns a held buffer, which must be given back by brelse().
+ *    bcache_read() copies any byte range, which may span several blocks.
+ * 3. Data is only read through the cache; anyone writing to a device behind
+ *    its back must call bcache_invalidate().
+ * 4. bcache_readahead() starts reading blocks that will be needed soon,
+ *    without waiting for them; adjacent blocks are merged into large
+ *    requests by the block layer.
+*/
+
+#ifndef BCACHE_H
+#define BCACHE_H
+
+#include "storage.h"
+#include "block.h"
+#include "util_list.h"
+
+
+#define BCACHE_HASH_SIZE		64			// a power of 2
+#define BCACHE_DEFAULT_BUDGET	(64*1024)	// bytes of block data
+
+/// States of buffers
+#define BH_UPTODATE		0x1		// data is valid
+#define BH_ERROR		0x2		// reading the block failed
+
+// A cached block
+struct buffer_head {
+	struct list_head hash;      // in a hash bucket
+	struct list_head lru;       // in the LRU list, the most recent at the tail
+	struct storage_device *sd;
+	unsigned int blocknr;
+	size_t size;
+	volatile unsigned int state;
+	int count;                  // # of holders
+	char *data;
+	struct bio bio;             // used by readahead
+	struct bio_vec vec;
+};
+
+struct bcache_stats {
+	unsigned int hits;
+	unsigned int misses;
+	unsigned int evictions;
+	unsigned int readaheads;    // # of blocks read ahead
+	unsigned int nr_buffers;
+	unsigned int size;          // bytes of block data
+	unsigned int budget;
+};
+
+
+int bcache_init(void);
+void bcache_set_budget(unsigned int bytes);
+struct buffer_head *bread(struct storage_device *sd, unsigned int blocknr);
+void brelse(struct buffer_head *bh);
+int bcache_readahead(struct storage_device *sd, unsigned int pos, size_t size);
+int bcache_read(struct storage_device *sd, void *dest, unsigned int pos, size_t size);
+void bcache_invalidate(struct storage_device *sd);
+void bcache_get_stats(struct bcache_stats *stats);
+
+
+#endif // BCACHE_H
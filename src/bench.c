@@ -0,0 +1,511 @@
+/* bench.c
+ * On-target micro benchmarks, built in with "make BENCH=1"
+ *
+ * NOTE
+ * 1. Each benchmark is timed with the clocksource and prints one line:
+ *        BENCH <name> iters=<n> ns_per_op=<n>
+ *    device reads add "kb_per_sec=<n>", and the memory and string routines
+ *    are compared with the byte loops they replaced:
+ *        BENCH <name> size=<n> align=<dest>/<src> byte_ns=<n> opt_ns=<n>
+ *    All results are between "BENCH BEGIN" and "BENCH END" lines, so that
+ *    they can be picked out of the UART log and compared across builds.
+ * 2. The benchmarks run at boot before any other process is created, so
+ *    that nothing else is scheduled in between.
+*/
+
+#include "syscall.h"
+#include "ring.h"
+#include "timer.h"
+#include "vdso.h"
+#include "fs.h"
+#include "file.h"
+#include "bcache.h"
+#include "memory.h"
+#include "string.h"
+#include "storage.h"
+#include "proc.h"
+#include "exec.h"
+#include "print.h"
+
+/* Print the result of a benchmark that ran "iters" operations in "cycles" */
+static void bench_report(const char *name, unsigned int iters, unsigned long long cycles)
+{
+	unsigned long long ns = cycles_to_ns(cycles);
+
+	printk("BENCH %s iters=%u ns_per_op=%u\n", name, iters, (unsigned int)(ns / iters));
+}
+
+/* Latency of a system call that does nothing, i.e., SWI entry, dispatch
+ * through syscall_table and return
+ */
+static void bench_null_syscall(void)
+{
+	unsigned long long t0, t1;
+	unsigned int i, iters = 10000;
+
+	t0 = clocksource_cycles();
+	for(i=0; i<iters; i++) {
+		syscall0(__NR_null);
+	}
+	t1 = clocksource_cycles();
+
+	bench_report("null_syscall", iters, t1 - t0);
+}
+
+/* Buddy allocation and free of 2^order pages, for a few orders */
+static void bench_pages(void)
+{
+	static const char *names[] = { "page_alloc_free_o0", "page_alloc_free_o2",
+		"page_alloc_free_o4" };
+	unsigned long long t0, t1;
+	unsigned int i, order, iters = 1000;
+	void *p;
+
+	for(order=0; order<=4; order+=2) {
+		t0 = clocksource_cycles();
+		for(i=0; i<iters; i++) {
+			if((p = get_free_pages(0, order)) == (void *)0) {
+				printk("BENCH %s FAILED\n", names[order/2]);
+				return;
+			}
+			put_free_pages(p, order);
+		}
+		t1 = clocksource_cycles();
+
+		bench_report(names[order/2], iters, t1 - t0);
+	}
+}
+
+/* kmalloc() and kfree() of a few sizes; each size has a slab cache */
+static void bench_kmalloc(void)
+{
+	static const unsigned int sizes[] = { 16, 64, 256, 1024, 4000 };
+	unsigned long long t0, t1;
+	unsigned int i, j, iters = 1000, ns;
+	void *p;
+
+	for(j=0; j<sizeof(sizes)/sizeof(sizes[0]); j++) {
+		t0 = clocksource_cycles();
+		for(i=0; i<iters; i++) {
+			if((p = kmalloc(sizes[j])) == (void *)0) {
+				printk("BENCH kmalloc size=%u FAILED\n", sizes[j]);
+				return;
+			}
+			kfree(p);
+		}
+		t1 = clocksource_cycles();
+
+		ns = (unsigned int)(cycles_to_ns(t1 - t0) / iters);
+		printk("BENCH kmalloc_kfree size=%u iters=%u ns_per_op=%u\n", sizes[j], iters, ns);
+	}
+}
+
+static volatile int bench_switch_stop;
+
+static int bench_switch_thread(void *unused)
+{
+	while(!bench_switch_stop) {
+		schedule();
+	}
+
+	return 0;
+}
+
+/* Process switch by schedule(), between this process and a thread doing the
+ * same; each loop is two switches
+ */
+static void bench_context_switch(void)
+{
+	unsigned long long t0, t1;
+	unsigned int i, iters = 5000;
+
+	bench_switch_stop = 0;
+	if(kernel_thread(bench_switch_thread, (void *)0) == (void *)0) {
+		return;
+	}
+	// Let the thread start
+	schedule();
+
+	t0 = clocksource_cycles();
+	for(i=0; i<iters; i++) {
+		schedule();
+	}
+	t1 = clocksource_cycles();
+
+	// Let the thread exit
+	bench_switch_stop = 1;
+	schedule();
+
+	bench_report("context_switch", iters*2, t1 - t0);
+}
+
+/* Null system calls batched through a ring: one __NR_ring_enter per 32 */
+static void bench_ring_null(void)
+{
+	unsigned long long t0, t1;
+	unsigned int i, j, iters = 10000, batch = 32;
+	struct ring *r;
+	struct ring_sqe *sqe;
+	int id;
+
+	if((id = ring_setup(batch, 0, &r)) < 0) {
+		return;
+	}
+
+	t0 = clocksource_cycles();
+	for(i=0; i<iters; i+=batch) {
+		for(j=0; j<batch; j++) {
+			sqe = ring_get_sqe(r);
+			sqe->opcode = __NR_null;
+			sqe->user_data = j;
+			ring_queue_sqe(r);
+		}
+		ring_submit(id, r, 0, 0);
+		while(ring_peek_cqe(r)) {
+			ring_cqe_seen(r);
+		}
+	}
+	t1 = clocksource_cycles();
+
+	ring_destroy(id);
+	bench_report("ring_null_batch32", iters, t1 - t0);
+}
+
+/* Time read through the vDSO page, without a trap */
+static void bench_vdso_clock(void)
+{
+	unsigned long long t0, t1;
+	unsigned int i, iters = 10000;
+
+	t0 = clocksource_cycles();
+	for(i=0; i<iters; i++) {
+		vdso_clock_gettime_ns();
+	}
+	t1 = clocksource_cycles();
+
+	bench_report("vdso_clock_gettime", iters, t1 - t0);
+}
+
+/* Lookup of a file in romfs; the inode comes from the inode cache */
+static void bench_romfs_namei(void)
+{
+	unsigned long long t0, t1;
+	unsigned int i, iters = 1000;
+	struct bcache_stats stats;
+	struct icache_stats istats;
+	struct inode *node;
+
+	t0 = clocksource_cycles();
+	for(i=0; i<iters; i++) {
+		if((node = fs_type[ROMFS]->namei(fs_type[ROMFS], "number.txt"))) {
+			iput(node);
+		}
+	}
+	t1 = clocksource_cycles();
+
+	bench_report("romfs_namei", iters, t1 - t0);
+
+	bcache_get_stats(&stats);
+	printk("BENCH bcache hits=%u misses=%u evictions=%u buffers=%u\n",
+		stats.hits, stats.misses, stats.evictions, stats.nr_buffers);
+
+	icache_get_stats(&istats);
+	printk("BENCH icache hits=%u misses=%u inodes=%u unused=%u\n",
+		istats.hits, istats.misses, istats.nr_inodes, istats.nr_unused);
+}
+
+/* Lookup of a file that does not exist in romfs, i.e., a hash probe miss */
+static void bench_romfs_namei_miss(void)
+{
+	unsigned long long t0, t1;
+	unsigned int i, iters = 1000;
+	struct inode *node;
+
+	t0 = clocksource_cycles();
+	for(i=0; i<iters; i++) {
+		if((node = fs_type[ROMFS]->namei(fs_type[ROMFS], "no-such-file"))) {
+			iput(node);
+		}
+	}
+	t1 = clocksource_cycles();
+
+	bench_report("romfs_namei_miss", iters, t1 - t0);
+}
+
+/* Reads of the ramdisk through "dout" of the storage device, i.e., the block
+ * layer, not the buffer cache
+ */
+static void bench_ramdisk_dout(void)
+{
+	static const unsigned int sizes[] = { 512, 4096 };
+	struct storage_device *sd = storage[RAMDISK];
+	unsigned long long t0, t1, ns;
+	unsigned int i, j, iters, total = 256*1024;
+	char *buf;
+
+	if((buf = (char *)get_free_pages(0, 0)) == (void *)0) {
+		return;
+	}
+
+	for(j=0; j<sizeof(sizes)/sizeof(sizes[0]); j++) {
+		iters = total / sizes[j];
+		t0 = clocksource_cycles();
+		for(i=0; i<iters; i++) {
+			if(sd->dout(sd, buf, i*sizes[j] % sd->storage_size, sizes[j])) {
+				printk("BENCH ramdisk_dout FAILED\n");
+				goto OUT;
+			}
+		}
+		t1 = clocksource_cycles();
+
+		ns = cycles_to_ns(t1 - t0);
+		printk("BENCH ramdisk_dout size=%u iters=%u ns_per_op=%u kb_per_sec=%u\n",
+			sizes[j], iters, (unsigned int)(ns / iters),
+			(unsigned int)(total * NSEC_PER_SEC / 1024 / (ns ? ns : 1)));
+	}
+
+OUT:
+	put_free_pages(buf, 0);
+}
+
+/* Loading and unloading an app; after the first time, it comes from the
+ * exec cache
+ */
+static void bench_exec(void)
+{
+	unsigned long long t0, t1;
+	unsigned int i, iters = 200;
+	struct exec_cache_stats stats;
+	struct exec_image img;
+
+	t0 = clocksource_cycles();
+	for(i=0; i<iters; i++) {
+		if(load_elf(fs_type[ROMFS], "app1.elf", EXEC_XIP, &img)) {
+			printk("BENCH exec_load FAILED\n");
+			return;
+		}
+		unload_elf(&img);
+	}
+	t1 = clocksource_cycles();
+
+	bench_report("exec_load_unload", iters, t1 - t0);
+
+	exec_cache_get_stats(&stats);
+	printk("BENCH exec_cache hits=%u misses=%u entries=%u\n",
+		stats.hits, stats.misses, stats.nr_entries);
+}
+
+/* Sequential read of a file through the descriptor system calls, starting
+ * with a cold buffer cache, so readahead does the device I/O
+ */
+static void bench_file_read(void)
+{
+	unsigned long long t0, t1;
+	unsigned int ops = 0, bytes = 0;
+	struct bcache_stats stats;
+	char buf[256];
+	int fd, n;
+
+	bcache_invalidate(fs_type[ROMFS]->device);
+	if((fd = open("/app2.elf", O_RDONLY)) < 0) {
+		return;
+	}
+
+	t0 = clocksource_cycles();
+	while((n = read(fd, buf, sizeof(buf))) > 0) {
+		ops++;
+		bytes += n;
+	}
+	t1 = clocksource_cycles();
+
+	close(fd);
+	if(ops == 0) {
+		return;
+	}
+	bench_report("file_read_256", ops, t1 - t0);
+
+	bcache_get_stats(&stats);
+	printk("BENCH file_read bytes=%u misses=%u readaheads=%u\n",
+		bytes, stats.misses, stats.readaheads);
+}
+
+/* ----------------- memory and string routines ------------------------ */
+
+#define BENCH_BUF_SIZE	4096
+
+static char bench_src[BENCH_BUF_SIZE+32] __attribute__((aligned(32)));
+static char bench_dst[BENCH_BUF_SIZE+32] __attribute__((aligned(32)));
+
+/// The byte loops used before string.s; GCC must not turn them into calls
+#define BENCH_NO_PATTERNS	__attribute__((noinline, optimize("no-tree-loop-distribute-patterns")))
+
+static BENCH_NO_PATTERNS void *byte_memcpy(void *dest, const void *src, unsigned int count)
+{
+	char *tmp = (char *) dest, *s = (char *) src;
+
+	while(count--) { *tmp++ = *s++; }
+
+	return dest;
+}
+
+static BENCH_NO_PATTERNS void *byte_memset(void *s, int c, unsigned int count)
+{
+	char *xs = (char *) s;
+
+	while (count--) { *xs++ = c; }
+
+	return s;
+}
+
+static BENCH_NO_PATTERNS unsigned int byte_strlen(const char *s)
+{
+	const char *sc;
+
+	for (sc = s; *sc != '\0'; ++sc);
+
+	return sc - s;
+}
+
+static BENCH_NO_PATTERNS int byte_strcmp(const char *cs, const char *ct)
+{
+	signed char res;
+
+	while (1) {
+		if ((res = *cs - *ct++) != 0 || !*cs++) { break; }
+	}
+
+	return res;
+}
+
+/// Operations timed by bench_string(); "size" is the # of bytes involved
+#define BENCH_MEMCPY	0
+#define BENCH_MEMSET	1
+#define BENCH_STRLEN	2
+#define BENCH_STRCMP	3
+
+static const char *bench_string_names[] = { "memcpy", "memset", "strlen", "strcmp" };
+
+/* Time "iters" runs of operation "op", either the byte loop or the optimized
+ * routine
+ *
+ * Return value: ns per run
+ */
+static unsigned int bench_string_run(int op, int opt, char *d, char *s,
+				unsigned int size, unsigned int iters)
+{
+	unsigned long long t0, t1;
+	unsigned int i;
+
+	t0 = clocksource_cycles();
+	for(i=0; i<iters; i++) {
+		switch(op) {
+			case BENCH_MEMCPY:
+				opt ? memcpy(d, s, size) : byte_memcpy(d, s, size);
+				break;
+			case BENCH_MEMSET:
+				opt ? memset(d, i, size) : byte_memset(d, i, size);
+				break;
+			case BENCH_STRLEN:
+				opt ? strlen(s) : byte_strlen(s);
+				break;
+			case BENCH_STRCMP:
+				opt ? strcmp(d, s) : byte_strcmp(d, s);
+				break;
+		}
+	}
+	t1 = clocksource_cycles();
+
+	return (unsigned int)(cycles_to_ns(t1 - t0) / iters);
+}
+
+/* Check the result of operation "op" against the byte loop
+ *
+ * Return value: 0 if they agree
+ */
+static int bench_string_check(int op, char *d, char *s, unsigned int size)
+{
+	unsigned int i;
+
+	switch(op) {
+		case BENCH_MEMCPY:
+			byte_memset(d, 0, size);
+			memcpy(d, s, size);
+			return byte_strcmp(d, s);
+		case BENCH_MEMSET:
+			memset(d, 0x5a, size);
+			for(i=0; i<size; i++) {
+				if(d[i] != 0x5a) { return -1; }
+			}
+			return d[size] != 'a';
+		case BENCH_STRLEN:
+			return strlen(s) != byte_strlen(s);
+		case BENCH_STRCMP:
+			return (strcmp(d, s) > 0) != (byte_strcmp(d, s) > 0);
+	}
+
+	return -1;
+}
+
+/* Compare the byte loops and string.s across sizes and alignments
+ *
+ * NOTE
+ * The results of both are checked against each other, so a broken routine
+ * shows up as "BENCH <name> MISMATCH".
+ */
+static void bench_string(void)
+{
+	static const unsigned int sizes[] = { 8, 64, 512, 4096 };
+	static const unsigned int aligns[][2] = { {0, 0}, {0, 1}, {1, 0}, {2, 3} };
+	unsigned int op, i, j, size, iters, byte_ns, opt_ns;
+	char *d, *s;
+
+	for(op=BENCH_MEMCPY; op<=BENCH_STRCMP; op++) {
+		for(i=0; i<sizeof(sizes)/sizeof(sizes[0]); i++) {
+			for(j=0; j<sizeof(aligns)/sizeof(aligns[0]); j++) {
+				size = sizes[i];
+				d = bench_dst + aligns[j][0];
+				s = bench_src + aligns[j][1];
+				iters = 256*1024 / (size + 64);
+
+				/// Strings of "size-1" chars, equal except for the last one
+				byte_memset(bench_src, 'a', sizeof(bench_src));
+				byte_memset(bench_dst, 'a', sizeof(bench_dst));
+				s[size-1] = '\0';
+				d[size-1] = '\0';
+				d[size-2] = 'b';
+
+				byte_ns = bench_string_run(op, 0, d, s, size, iters);
+				opt_ns = bench_string_run(op, 1, d, s, size, iters);
+
+				if(bench_string_check(op, d, s, size)) {
+					printk("BENCH %s MISMATCH size=%u align=%u/%u\n",
+						bench_string_names[op], size, aligns[j][0], aligns[j][1]);
+					continue;
+				}
+
+				printk("BENCH %s size=%u align=%u/%u byte_ns=%u opt_ns=%u\n",
+					bench_string_names[op], size, aligns[j][0], aligns[j][1],
+					byte_ns, opt_ns);
+			}
+		}
+	}
+}
+
+/* Run all benchmarks */
+void run_benchmarks(void)
+{
+	printk("BENCH BEGIN hz=%u clocksource_hz=%u\n", HZ, clocksource_freq());
+	bench_pages();
+	bench_kmalloc();
+	bench_context_switch();
+	bench_null_syscall();
+	bench_ring_null();
+	bench_vdso_clock();
+	bench_romfs_namei();
+	bench_romfs_namei_miss();
+	bench_ramdisk_dout();
+	bench_exec();
+	bench_file_read();
+	bench_string();
+	printk("BENCH END\n");
+}
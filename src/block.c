@@ -0,0 +1,269 @@
+/* block.c
+ * Block request layer, see block.h
+*/
+
+#include "block.h"
+#include "interrupt.h"
+#include "proc.h"
+
+#define NULL ((void *)0)
+
+/* Initialize the request queue "q" of device "sd", whose driver starts the
+ * queued requests in "fn"
+ */
+void blk_init_queue(struct request_queue *q, request_fn_t *fn, struct storage_device *sd)
+{
+	int i;
+
+	INIT_LIST_HEAD(&q->queue_head);
+	INIT_LIST_HEAD(&q->free_list);
+	for(i=0; i<BLK_NR_REQUESTS; i++) {
+		list_add_tail(&q->rqs[i].queuelist, &q->free_list);
+	}
+
+	q->plugged = 0;
+	q->request_fn = fn;
+	q->sd = sd;
+	q->nr_bios = q->nr_merges = q->nr_dispatched = 0;
+
+	sd->queue = q;
+}
+
+/* Hand the queued requests to the driver; called with interrupts disabled */
+static void __blk_run_queue(struct request_queue *q)
+{
+	if(!list_empty(&q->queue_head)) {
+		q->request_fn(q);
+	}
+}
+
+/* Try to merge "bio" into a queued request
+ *
+ * NOTE
+ * A bio can be appended to a request that ends where the bio starts (back
+ * merge), or put in front of a request that starts where the bio ends (front
+ * merge), as long as the request does not get too many segments.
+ *
+ * Return value: 1 if merged, 0 otherwise
+ */
+static int blk_attempt_merge(struct request_queue *q, struct bio *bio)
+{
+	struct list_head *pos;
+	struct request *rq;
+
+	list_for_each(pos, &q->queue_head) {
+		rq = list_entry(pos, struct request, queuelist);
+
+		if(rq->dir != bio->dir || rq->nr_segs + bio->nr_vecs > BLK_MAX_SEGMENTS) {
+			continue;
+		}
+
+		if(rq->pos + rq->size == bio->pos) {
+			rq->biotail->next = bio;
+			rq->biotail = bio;
+		} else if(bio->pos + bio->size == rq->pos) {
+			bio->next = rq->bio;
+			rq->bio = bio;
+			rq->pos = bio->pos;
+		} else {
+			continue;
+		}
+
+		rq->size += bio->size;
+		rq->nr_segs += bio->nr_vecs;
+		q->nr_merges++;
+
+		return 1;
+	}
+
+	return 0;
+}
+
+/* Submit "bio" to request queue "q"
+ *
+ * NOTE
+ * When all requests of the queue are in use, the queue is run even if it is
+ * plugged, and the caller waits until the driver has completed one of them.
+ *
+ * Return value: 0 on success; -1 if "bio" is invalid, in which case "end_io"
+ *  is not called
+ */
+int submit_bio(struct request_queue *q, struct bio *bio)
+{
+	struct request *rq;
+	unsigned int flags;
+	size_t size = 0;
+	int i;
+
+	if(bio->nr_vecs == 0 || bio->nr_vecs > BLK_MAX_SEGMENTS) {
+		return -1;
+	}
+	for(i=0; i<bio->nr_vecs; i++) {
+		size += bio->vecs[i].len;
+	}
+	if(size == 0 || bio->pos + size > q->sd->storage_size || bio->pos + size < bio->pos) {
+		return -1;
+	}
+	bio->size = size;
+	bio->next = NULL;
+
+	flags = local_irq_save();
+	q->nr_bios++;
+
+	if(blk_attempt_merge(q, bio)) {
+		goto OUT;
+	}
+
+	if(list_empty(&q->free_list)) {
+		__blk_run_queue(q);
+		while(list_empty(&q->free_list)) {
+			local_irq_restore(flags);
+			schedule();
+			flags = local_irq_save();
+		}
+	}
+
+	rq = list_entry(q->free_list.next, struct request, queuelist);
+	list_del(&rq->queuelist);
+	rq->dir = bio->dir;
+	rq->pos = bio->pos;
+	rq->size = bio->size;
+	rq->nr_segs = bio->nr_vecs;
+	rq->bio = rq->biotail = bio;
+	list_add_tail(&rq->queuelist, &q->queue_head);
+
+OUT:
+	if(!q->plugged) {
+		__blk_run_queue(q);
+	}
+	local_irq_restore(flags);
+
+	return 0;
+}
+
+/* Take the oldest queued request; called by the driver in "request_fn"
+ *
+ * Return value: the request, or NULL if the queue is empty
+ */
+struct request *blk_fetch_request(struct request_queue *q)
+{
+	struct request *rq;
+
+	if(list_empty(&q->queue_head)) {
+		return NULL;
+	}
+
+	rq = list_entry(q->queue_head.next, struct request, queuelist);
+	list_del_init(&rq->queuelist);
+	q->nr_dispatched++;
+
+	return rq;
+}
+
+/* Complete all the bios of request "rq" and free it; called by the driver */
+void blk_end_request(struct request_queue *q, struct request *rq, int error)
+{
+	struct bio *bio, *next;
+	unsigned int flags;
+
+	for(bio=rq->bio; bio; bio=next) {
+		next = bio->next;
+		bio->next = NULL;
+		bio->end_io(bio, error ? -1 : 0);
+	}
+
+	flags = local_irq_save();
+	list_add(&rq->queuelist, &q->free_list);
+	local_irq_restore(flags);
+}
+
+/* Hand the queued requests to the driver, even if the queue is plugged */
+void blk_run_queue(struct request_queue *q)
+{
+	unsigned int flags;
+
+	flags = local_irq_save();
+	__blk_run_queue(q);
+	local_irq_restore(flags);
+}
+
+/* Hold back the requests of "q" so that following bios can be merged;
+ * calls can be nested
+ */
+void blk_plug(struct request_queue *q)
+{
+	unsigned int flags;
+
+	flags = local_irq_save();
+	q->plugged++;
+	local_irq_restore(flags);
+}
+
+/* Undo blk_plug(); the last call hands the collected requests to the driver */
+void blk_unplug(struct request_queue *q)
+{
+	unsigned int flags;
+
+	flags = local_irq_save();
+	if(q->plugged > 0 && --q->plugged == 0) {
+		__blk_run_queue(q);
+	}
+	local_irq_restore(flags);
+}
+
+/* ----------------- Synchronous I/O ------------------------ */
+
+static void bio_end_io_sync(struct bio *bio, int error)
+{
+	*(volatile int *)bio->private = error ? -1 : 1;
+}
+
+/* Read or write "size" bytes at offset "pos" of device "sd", and wait until
+ * the I/O has completed
+ *
+ * Return value: 0 on success, -1 on error
+ */
+int blk_rw_sync(struct storage_device *sd, unsigned int dir, void *buf,
+				unsigned int pos, size_t size)
+{
+	struct bio_vec vec;
+	struct bio bio;
+	volatile int done = 0;
+
+	if(sd->queue == NULL) {
+		return -1;
+	}
+
+	vec.buf = buf;
+	vec.len = size;
+	bio.dir = dir;
+	bio.pos = pos;
+	bio.vecs = &vec;
+	bio.nr_vecs = 1;
+	bio.end_io = bio_end_io_sync;
+	bio.private = (void *)&done;
+
+	if(submit_bio(sd->queue, &bio)) {
+		return -1;
+	}
+	// Do not wait for others to unplug the queue
+	blk_run_queue(sd->queue);
+
+	while(!done) {
+		schedule();
+	}
+
+	return done < 0 ? -1 : 0;
+}
+
+/* "dout" of devices that use a request queue: read from the device */
+int blk_dout(struct storage_device *sd, void *dest, unsigned int pos, size_t size)
+{
+	return blk_rw_sync(sd, READ, dest, pos, size);
+}
+
+/* "din" of devices that use a request queue: write to the device */
+int blk_din(struct storage_device *sd, void *src, unsigned int pos, size_t size)
+{
+	return blk_rw_sync(sd, WRITE, src, pos, size);
+}
@@ -0,0 +1,105 @@
+/* block.h
+ * Block request layer between file systems and storage device drivers
+ *
+ * NOTE
+ * 1. An I/O is described by a "struct bio": a direction, a byte offset in the
+ *    device and a scatter-gather list of memory segments ("struct bio_vec").
+ *    It is submitted with submit_bio(), and its "end_io" callback is called
+ *    when it completes, possibly from interrupt context.
+ * 2. Submitted bios are put into "struct request"s queued on the device's
+ *    request queue. A bio that is adjacent to a queued request of the same
+ *    direction is merged into it, so that the driver sees one larger request
+ *    with more segments.
+ * 3. While a queue is plugged, requests are only collected, which gives bios
+ *    submitted in a row the chance to be merged; unplugging hands them all to
+ *    the driver through "request_fn". An unplugged queue hands each request
+ *    over at once.
+ * 4. The driver calls blk_end_request() when a request has completed.
+*/
+
+#ifndef BLOCK_H
+#define BLOCK_H
+
+#include "storage.h"
+#include "util_list.h"
+
+
+/// Directions of I/O
+#define READ	0	// from device to memory
+#define WRITE	1	// from memory to device
+
+#define BLK_MAX_SEGMENTS	16	// max # of segments in a request
+#define BLK_NR_REQUESTS		16	// # of requests of a queue
+
+// A memory segment of an I/O
+struct bio_vec {
+	void *buf;
+	size_t len;
+};
+
+struct bio;
+typedef void (bio_end_io_t)(struct bio *bio, int error);
+
+// An I/O submitted to the block layer
+struct bio {
+	unsigned int dir;
+	unsigned int pos;           // byte offset in the device
+	size_t size;                // total # of bytes of the segments
+	struct bio_vec *vecs;
+	unsigned int nr_vecs;
+	bio_end_io_t *end_io;       // called on completion; error is 0 or -1
+	void *private;              // for "end_io"
+	struct bio *next;           // next bio in the same request
+};
+
+// One or more adjacent bios, as handed to the driver
+struct request {
+	struct list_head queuelist;
+	unsigned int dir;
+	unsigned int pos;           // byte offset in the device
+	size_t size;
+	unsigned int nr_segs;       // # of segments of all bios
+	struct bio *bio;            // bios sorted by "pos"
+	struct bio *biotail;
+};
+
+struct request_queue;
+// Start the queued requests; called with interrupts disabled
+typedef void (request_fn_t)(struct request_queue *q);
+
+struct request_queue {
+	struct list_head queue_head;    // requests not yet taken by the driver
+	struct list_head free_list;     // unused requests
+	struct request rqs[BLK_NR_REQUESTS];
+	int plugged;
+	request_fn_t *request_fn;
+	struct storage_device *sd;
+	void *queuedata;                // for the driver
+
+	/// Statistics
+	unsigned int nr_bios;
+	unsigned int nr_merges;
+	unsigned int nr_dispatched;
+};
+
+/// Iterate over the segments of a request
+#define rq_for_each_segment(bv, rq, bio, i) \
+	for ((bio) = (rq)->bio; (bio); (bio) = (bio)->next) \
+		for ((i) = 0, (bv) = (bio)->vecs; (i) < (bio)->nr_vecs; (i)++, (bv)++)
+
+
+void blk_init_queue(struct request_queue *q, request_fn_t *fn, struct storage_device *sd);
+int submit_bio(struct request_queue *q, struct bio *bio);
+struct request *blk_fetch_request(struct request_queue *q);
+void blk_end_request(struct request_queue *q, struct request *rq, int error);
+void blk_run_queue(struct request_queue *q);
+void blk_plug(struct request_queue *q);
+void blk_unplug(struct request_queue *q);
+
+int blk_rw_sync(struct storage_device *sd, unsigned int dir, void *buf,
+				unsigned int pos, size_t size);
+int blk_dout(struct storage_device *sd, void *dest, unsigned int pos, size_t size);
+int blk_din(struct storage_device *sd, void *src, unsigned int pos, size_t size);
+
+
+#endif // BLOCK_H
@@ -82,6 +82,7 @@ struct elf32_phdr {
 #define ET_HIPROC		0xffff
 #define CHECK_ELF_TYPE(p)			((p)->e_type)
 #define CHECK_ELF_TYPE_EXEC(p)		(CHECK_ELF_TYPE(p)==ET_EXEC)
+#define CHECK_ELF_TYPE_DYN(p)		(CHECK_ELF_TYPE(p)==ET_DYN)
 
 /// ELF machines
 #define EM_NONE			0
@@ -121,5 +122,38 @@ struct elf32_phdr {
 #define CHECK_PT_TYPE(p)		((p)->p_type)
 #define CHECK_PT_TYPE_LOAD(p)	(CHECK_PT_TYPE(p)==PT_LOAD)
 
+/// Segment flags
+#define PF_X					0x1
+#define PF_W					0x2
+#define PF_R					0x4
+#define CHECK_PF_WRITE(p)		((p)->p_flags & PF_W)
+
+// Entry of the dynamic segment
+struct elf32_dyn {
+	elf32_sword	d_tag;     // DT_*
+	elf32_word	d_val;     // a value or an addr, by the tag
+};
+
+/// Dynamic entry tags
+#define DT_NULL					0	// end of the dynamic segment
+#define DT_RELA					7
+#define DT_REL					17	// addr of the relocation table
+#define DT_RELSZ				18	// size of it in bytes
+#define DT_RELENT				19	// size of an entry of it
+#define DT_TEXTREL				22
+
+// Relocation entry without addend; the addend is the word relocated
+struct elf32_rel {
+	elf32_addr	r_offset;  // addr of the word to relocate
+	elf32_word	r_info;    // symbol index and relocation type
+};
+
+#define ELF32_R_SYM(i)			((i) >> 8)
+#define ELF32_R_TYPE(i)			((i) & 0xff)
+
+/// ARM relocation types
+#define R_ARM_NONE				0
+#define R_ARM_RELATIVE			23	// word += load bias
+
 
 #endif // ELF_H
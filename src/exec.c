@@ -1,13 +1,767 @@
-/* exec.c */
+/* exec.c
+ * Loading and running apps
+ *
+ * NOTE
+ * 1. An ELF app is loaded segment by segment. A segment linked into memory
+ *    that is mapped 1:1 by sections, e.g., 0x30100000, is simply copied to
+ *    its addr. Otherwise it is mapped page by page, with map_page().
+ * 2. With EXEC_XIP, a read-only segment of a file on a memory-mapped device
+ *    (the ramdisk) is executed in place: its pages are mapped straight to the
+ *    device, so nothing is copied. This needs the segment to be at the same
+ *    offset in a page of the device as in memory, which "genromfs -a 4096"
+ *    and "-z max-page-size=4096" ensure, to have no BSS and to share no page
+ *    with another segment. Writable pages are always allocated, filled with
+ *    the data of the file and zeroed beyond it.
+ * 3. Caches are disabled, so no cache maintenance is done after loading.
+ * 4. Loaded apps are kept in a list, so that an app is not loaded over the
+ *    pages of another one. When its process exits, its pages are unmapped
+ *    and those allocated are freed.
+ * 5. An app is parsed once into a "struct exec_cache_entry": what to map at
+ *    each page of it, with a pristine copy of every page that is not executed
+ *    in place. Entries of files of read-only file systems are cached by
+ *    inode, so launching the app again reads nothing from the file: pages of
+ *    read-only segments are mapped to the cached copies, which are shared,
+ *    and only writable pages are copied. Up to EXEC_CACHE_SIZE entries are
+ *    kept; the least recently used ones with no users are dropped.
+ * 6. A position-independent app (ET_DYN, built with "-fpie -pie") can run at
+ *    any addr. It is copied to a block of free pages, which are mapped 1:1 by
+ *    sections, so no page is mapped, and its R_ARM_RELATIVE relocations are
+ *    applied there with the difference of its addr and its link addr, i.e.,
+ *    the load bias. Many such apps run side by side this way.
+ */
+
+#include "exec.h"
+#include "elf.h"
+#include "mmu.h"
+#include "memory.h"
+#include "string.h"
+#include "interrupt.h"
+#include "proc.h"
+#include "file.h"
+
+#define NULL ((void *)0)
+
+#define PAGE_DOWN(x)	((x) & PAGE_MASK)
+#define PAGE_UP(x)		(((x) + PAGE_SIZE - 1) & PAGE_MASK)
+
+#define EXEC_CACHE_SIZE	4			// max # of cached apps
+#define EXEC_MAX_PAGES	256			// max # of pages an app takes
+
+/// Kinds of pages of an app
+#define EXEC_PAGE_NONE		0	// not in any segment; not mapped
+#define EXEC_PAGE_XIP		1	// mapped to the device in place
+#define EXEC_PAGE_SHARED	2	// read-only; mapped to the pristine copy
+#define EXEC_PAGE_COPY		3	// writable; a copy of the pristine one, or 0s
+
+struct exec_page {
+	unsigned int addr;          // physical addr on the device, or of the copy
+	unsigned int kind;
+};
+
+// An app parsed, and the pristine copies of its pages
+struct exec_cache_entry {
+	struct list_head list;      // in "exec_cache", the most recent first
+	struct inode *inode;        // key; a reference is held while cached
+	unsigned int flags;         // of load_elf() it was parsed with
+	unsigned int users;         // # of loaded images using it
+	int cached;
+	unsigned int entry;
+	unsigned int start, end;    // page-aligned range of all its segments
+	int direct;                 // in memory mapped by sections, or PIE
+	int pie;                    // position independent, see NOTE 6
+	int order;                  // of the pages a PIE app is copied to
+	unsigned int rel, relsz;    // relocation table of a PIE app, by link addr
+	unsigned int nr_segs;       // the segments, to copy only them if "direct"
+	struct {
+		unsigned int vaddr, memsz;
+	} segs[EXEC_MAX_PHDRS];
+	struct exec_page pages[0];  // one per page from "start" to "end"
+};
+
+// Apps loaded, from load_elf() to unload_elf()
+static struct list_head exec_images = { &exec_images, &exec_images };
+
+static struct list_head exec_cache = { &exec_cache, &exec_cache };
+static struct exec_cache_stats estats;
+
+
+/* Check the ELF header of an app
+ *
+ * Return value: 0 if it is a 32-bit little-endian ARM executable
+ */
+static int elf_check(struct elf32_ehdr *ehdr)
+{
+	if(!ELF_FILE_CHECK(ehdr) || !CHECK_ELF_CLASS_ELFCLASS32(ehdr) ||
+		!CHECK_ELF_DATA_LSB(ehdr) ||
+		(!CHECK_ELF_TYPE_EXEC(ehdr) && !CHECK_ELF_TYPE_DYN(ehdr)) ||
+		!CHECK_ELF_MACHINE_ARM(ehdr)) {
+		return -1;
+	}
+	if(ehdr->e_phentsize != sizeof(struct elf32_phdr) ||
+		ehdr->e_phnum == 0 || ehdr->e_phnum > EXEC_MAX_PHDRS) {
+		return -1;
+	}
+
+	return 0;
+}
+
+/* Check whether segment "i" can be executed in place */
+static int elf_can_xip(struct inode *node, struct elf32_phdr *phdrs, int nr, int i)
+{
+	struct elf32_phdr *ph = &phdrs[i];
+	unsigned int start = PAGE_DOWN(ph->p_vaddr), end = PAGE_UP(ph->p_vaddr + ph->p_memsz);
+	unsigned int daddr;
+	int j;
+
+	if(node->super->device->phys_pos == 0 || node->super->get_daddr == NULL) {
+		return 0;
+	}
+	if(CHECK_PF_WRITE(ph) || ph->p_filesz != ph->p_memsz) {
+		return 0;
+	}
+
+	daddr = node->super->get_daddr(node) + ph->p_offset;
+	if((daddr & ~PAGE_MASK) != (ph->p_vaddr & ~PAGE_MASK)) {
+		return 0;
+	}
+
+	/// No other segment may share its pages
+	for(j=0; j<nr; j++) {
+		if(j != i && CHECK_PT_TYPE_LOAD(&phdrs[j]) &&
+			PAGE_DOWN(phdrs[j].p_vaddr) < end &&
+			PAGE_UP(phdrs[j].p_vaddr + phdrs[j].p_memsz) > start) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/* Free an entry and the pristine copies of its pages */
+static void exec_free_entry(struct exec_cache_entry *ent)
+{
+	unsigned int i;
+
+	for(i=0; i<(ent->end - ent->start) >> PAGE_SHIFT; i++) {
+		if(ent->pages[i].kind != EXEC_PAGE_XIP && ent->pages[i].addr) {
+			put_free_pages((void *)ent->pages[i].addr, 0);
+		}
+	}
+	kfree(ent);
+}
+
+/* Note the pages of segment "ph" to be mapped to the device in place */
+static void elf_parse_xip(struct exec_cache_entry *ent, struct inode *node,
+				struct elf32_phdr *ph)
+{
+	struct exec_page *p;
+	unsigned int va, paddr;
+
+	paddr = node->super->device->phys_pos + node->super->get_daddr(node) +
+		ph->p_offset - (ph->p_vaddr & ~PAGE_MASK);
+
+	for(va=PAGE_DOWN(ph->p_vaddr); va<ph->p_vaddr+ph->p_memsz; va+=PAGE_SIZE) {
+		p = &ent->pages[(va - ent->start) >> PAGE_SHIFT];
+		p->addr = paddr;
+		p->kind = EXEC_PAGE_XIP;
+		paddr += PAGE_SIZE;
+	}
+}
+
+/* Read the pages of segment "ph" from the file into their pristine copies
+ *
+ * NOTE
+ * A page may be shared with another segment; it is writable if either one
+ * is. A writable page with nothing from the file has no copy, and is zeroed
+ * when loaded.
+ */
+static int elf_parse_copy(struct exec_cache_entry *ent, struct inode *node,
+				struct elf32_phdr *ph)
+{
+	unsigned int va, start, end, fend = ph->p_vaddr + ph->p_filesz;
+	struct exec_page *p;
+
+	for(va=PAGE_DOWN(ph->p_vaddr); va<ph->p_vaddr+ph->p_memsz; va+=PAGE_SIZE) {
+		p = &ent->pages[(va - ent->start) >> PAGE_SHIFT];
+
+		/// The part of the page backed by the file; the rest stays 0
+		start = va > ph->p_vaddr ? va : ph->p_vaddr;
+		end = va + PAGE_SIZE < fend ? va + PAGE_SIZE : fend;
+
+		if(p->addr == 0 && (start < end || !CHECK_PF_WRITE(ph))) {
+			if((p->addr = (unsigned int)get_free_pages(0, 0)) == 0) {
+				return -1;
+			}
+			memset((void *)p->addr, 0, PAGE_SIZE);
+		}
+		if(start < end && node->super->read(node, (char *)p->addr + (start - va),
+				ph->p_offset + (start - ph->p_vaddr), end - start) != end - start) {
+			return -1;
+		}
+
+		if(CHECK_PF_WRITE(ph)) {
+			p->kind = EXEC_PAGE_COPY;
+		} else if(p->kind == EXEC_PAGE_NONE) {
+			p->kind = EXEC_PAGE_SHARED;
+		}
+	}
+
+	return 0;
+}
+
+/* Find the relocation table of a PIE app in its dynamic segment "ph"
+ *
+ * Return value: 0 on success, -1 if the table is bad or has entries with
+ *  addends (DT_RELA), which are not used on ARM
+ */
+static int elf_parse_dynamic(struct exec_cache_entry *ent, struct inode *node,
+				struct elf32_phdr *ph)
+{
+	struct elf32_dyn dyn[16];
+	unsigned int pos, n, i, relent = sizeof(struct elf32_rel);
+
+	for(pos=0; pos<ph->p_filesz; pos+=n) {
+		n = ph->p_filesz - pos < sizeof(dyn) ? ph->p_filesz - pos : sizeof(dyn);
+		n -= n % sizeof(struct elf32_dyn);
+		if(n == 0 || node->super->read(node, dyn, ph->p_offset + pos, n) != n) {
+			return -1;
+		}
+		for(i=0; i<n/sizeof(struct elf32_dyn); i++) {
+			switch(dyn[i].d_tag) {
+				case DT_NULL:
+					goto END;
+				case DT_REL:
+					ent->rel = dyn[i].d_val;
+					break;
+				case DT_RELSZ:
+					ent->relsz = dyn[i].d_val;
+					break;
+				case DT_RELENT:
+					relent = dyn[i].d_val;
+					break;
+				case DT_RELA:
+					return -1;
+			}
+		}
+	}
+
+END:
+	if(ent->relsz == 0) {
+		return 0;
+	}
+	if(relent != sizeof(struct elf32_rel) || (ent->rel & 3) ||
+		ent->rel < ent->start || ent->rel > ent->end ||
+		ent->relsz > ent->end - ent->rel || ent->relsz % relent) {
+		return -1;
+	}
+
+	return 0;
+}
+
+/* Parse ELF app "node", and read the pages not executed in place
+ *
+ * Return value: the new entry, or NULL on error
+ */
+static struct exec_cache_entry *elf_parse(struct inode *node, unsigned int flags)
+{
+	struct super_block *super = node->super;
+	struct elf32_ehdr ehdr;
+	struct elf32_phdr phdrs[EXEC_MAX_PHDRS], *ph;
+	struct exec_cache_entry *ent;
+	unsigned int start = 0xffffffff, end = 0, nr;
+	int i;
+
+	if(super->read(node, &ehdr, 0, sizeof(ehdr)) != sizeof(ehdr) || elf_check(&ehdr)) {
+		return NULL;
+	}
+	if(super->read(node, phdrs, ehdr.e_phoff, ehdr.e_phnum*sizeof(struct elf32_phdr)) !=
+			ehdr.e_phnum*sizeof(struct elf32_phdr)) {
+		return NULL;
+	}
+
+	/// Check all segments, and find the range of pages they take
+	for(i=0; i<ehdr.e_phnum; i++) {
+		ph = &phdrs[i];
+		if(!CHECK_PT_TYPE_LOAD(ph) || ph->p_memsz == 0) {
+			continue;
+		}
+		if(ph->p_filesz > ph->p_memsz || ph->p_offset + ph->p_filesz > node->dsize ||
+			ph->p_offset + ph->p_filesz < ph->p_offset ||
+			ph->p_vaddr + ph->p_memsz < ph->p_vaddr ||
+			ph->p_vaddr + ph->p_memsz > PAGE_MASK) {
+			return NULL;
+		}
+		if(PAGE_DOWN(ph->p_vaddr) < start) {
+			start = PAGE_DOWN(ph->p_vaddr);
+		}
+		if(PAGE_UP(ph->p_vaddr + ph->p_memsz) > end) {
+			end = PAGE_UP(ph->p_vaddr + ph->p_memsz);
+		}
+	}
+	if(start >= end || ehdr.e_entry < start || ehdr.e_entry >= end) {
+		return NULL;
+	}
+	// All in memory mapped by sections, or none
+	if(!CHECK_ELF_TYPE_DYN(&ehdr) && section_mapped(start) != section_mapped(end - 1)) {
+		return NULL;
+	}
+	if((nr = (end - start) >> PAGE_SHIFT) > EXEC_MAX_PAGES) {
+		return NULL;
+	}
+
+	ent = (struct exec_cache_entry *)kmalloc(sizeof(struct exec_cache_entry) +
+			nr*sizeof(struct exec_page));
+	if(ent == NULL) {
+		return NULL;
+	}
+	memset(ent, 0, sizeof(struct exec_cache_entry) + nr*sizeof(struct exec_page));
+	ent->flags = flags;
+	ent->entry = ehdr.e_entry;
+	ent->start = start;
+	ent->end = end;
+	ent->direct = section_mapped(start);
+
+	if(CHECK_ELF_TYPE_DYN(&ehdr)) {
+		ent->direct = ent->pie = 1;
+		for(ent->order=0; (PAGE_SIZE << ent->order) < end - start; ent->order++);
+		for(i=0; i<ehdr.e_phnum; i++) {
+			if(CHECK_PT_TYPE(&phdrs[i]) == PT_DYNAMIC &&
+				elf_parse_dynamic(ent, node, &phdrs[i])) {
+				kfree(ent);
+				return NULL;
+			}
+		}
+	}
+
+	for(i=0; i<ehdr.e_phnum; i++) {
+		ph = &phdrs[i];
+		if(!CHECK_PT_TYPE_LOAD(ph) || ph->p_memsz == 0) {
+			continue;
+		}
+		ent->segs[ent->nr_segs].vaddr = ph->p_vaddr;
+		ent->segs[ent->nr_segs++].memsz = ph->p_memsz;
+		if(!ent->direct && (flags & EXEC_XIP) && elf_can_xip(node, phdrs, ehdr.e_phnum, i)) {
+			elf_parse_xip(ent, node, ph);
+		} else if(elf_parse_copy(ent, node, ph)) {
+			exec_free_entry(ent);
+			return NULL;
+		}
+	}
+
+	return ent;
+}
+
+/* Find the cached entry of "node"; called with interrupts disabled */
+static struct exec_cache_entry *exec_cache_find(struct inode *node, unsigned int flags)
+{
+	struct list_head *pos;
+	struct exec_cache_entry *ent;
+
+	list_for_each(pos, &exec_cache) {
+		ent = list_entry(pos, struct exec_cache_entry, list);
+		if(ent->inode == node && ent->flags == flags) {
+			return ent;
+		}
+	}
+
+	return NULL;
+}
+
+/* Drop the least recently used entries with no users, while there are more
+ * than EXEC_CACHE_SIZE
+ */
+static void exec_cache_shrink(void)
+{
+	struct exec_cache_entry *ent;
+	struct list_head *pos;
+	unsigned int flags;
+
+	while(1) {
+		flags = local_irq_save();
+		ent = NULL;
+		if(estats.nr_entries > EXEC_CACHE_SIZE) {
+			for(pos=exec_cache.prev; pos!=&exec_cache; pos=pos->prev) {
+				if(list_entry(pos, struct exec_cache_entry, list)->users == 0) {
+					ent = list_entry(pos, struct exec_cache_entry, list);
+					list_del(&ent->list);
+					estats.nr_entries--;
+					break;
+				}
+			}
+		}
+		local_irq_restore(flags);
+
+		if(ent == NULL) {
+			return;
+		}
+		iput(ent->inode);
+		exec_free_entry(ent);
+	}
+}
+
+/* Get the parsed app "path" of file system "super"
+ *
+ * NOTE
+ * Only files of read-only file systems whose inodes are in the inode cache
+ * are cached, as their inodes stay the same and their data does not change.
+ * Others are parsed each time, and freed with their image.
+ *
+ * Return value: the entry, with a user added, or NULL on error
+ */
+static struct exec_cache_entry *exec_cache_get(struct super_block *super, char *path,
+					unsigned int flags)
+{
+	struct exec_cache_entry *ent, *old;
+	struct inode *node;
+	unsigned int irq;
+	int cached;
+
+	if(super->read == NULL || (node = super->namei(super, path)) == NULL) {
+		return NULL;
+	}
+	cached = super->write == NULL && (node->state & I_CACHED);
+
+	if(cached) {
+		irq = local_irq_save();
+		if((ent = exec_cache_find(node, flags))) {
+			ent->users++;
+			list_del(&ent->list);
+			list_add(&ent->list, &exec_cache);
+			estats.hits++;
+			local_irq_restore(irq);
+			iput(node);
+			return ent;
+		}
+		estats.misses++;
+		local_irq_restore(irq);
+	}
+
+	if((ent = elf_parse(node, flags)) == NULL) {
+		iput(node);
+		return NULL;
+	}
+	ent->users = 1;
+	ent->cached = cached;
+	if(!cached) {
+		iput(node);
+		return ent;
+	}
+
+	/// The reference to the inode got from namei() is kept by the entry
+	irq = local_irq_save();
+	if((old = exec_cache_find(node, flags))) {
+		// Parsed meanwhile by another process
+		old->users++;
+		local_irq_restore(irq);
+		iput(node);
+		exec_free_entry(ent);
+		return old;
+	}
+	ent->inode = node;
+	list_add(&ent->list, &exec_cache);
+	estats.nr_entries++;
+	local_irq_restore(irq);
+
+	exec_cache_shrink();
+
+	return ent;
+}
+
+/* Drop a user of an entry */
+static void exec_cache_put(struct exec_cache_entry *ent)
+{
+	unsigned int flags;
+	int idle;
+
+	flags = local_irq_save();
+	idle = --ent->users == 0;
+	local_irq_restore(flags);
+
+	if(idle && !ent->cached) {
+		exec_free_entry(ent);
+	} else if(idle) {
+		exec_cache_shrink();
+	}
+}
+
+/* Copy the segments of a parsed app in memory mapped by sections to their
+ * addrs plus "bias"; the memory around them in their pages is left as it is
+ */
+static void exec_copy_direct(struct exec_cache_entry *ent, struct exec_image *img,
+				unsigned int bias)
+{
+	struct exec_page *p;
+	unsigned int i, va, start, end;
+
+	for(i=0; i<ent->nr_segs; i++) {
+		for(va=PAGE_DOWN(ent->segs[i].vaddr); va<ent->segs[i].vaddr+ent->segs[i].memsz;
+				va+=PAGE_SIZE) {
+			p = &ent->pages[(va - ent->start) >> PAGE_SHIFT];
+			start = va > ent->segs[i].vaddr ? va : ent->segs[i].vaddr;
+			end = va + PAGE_SIZE < ent->segs[i].vaddr + ent->segs[i].memsz ?
+				va + PAGE_SIZE : ent->segs[i].vaddr + ent->segs[i].memsz;
+			if(p->addr) {
+				memcpy((void *)(start + bias), (char *)p->addr + (start - va), end - start);
+			} else {
+				memset((void *)(start + bias), 0, end - start);
+			}
+		}
+	}
+	img->copied_pages = (ent->end - ent->start) >> PAGE_SHIFT;
+}
+
+/* Apply the relocations of a PIE app copied to its link addrs plus "bias"
+ *
+ * Return value: 0 on success, -1 on a relocation that is not supported or
+ *  out of the app
+ */
+static int exec_relocate(struct exec_cache_entry *ent, unsigned int bias)
+{
+	struct elf32_rel *rel = (struct elf32_rel *)(ent->rel + bias);
+	unsigned int i;
+
+	for(i=0; i<ent->relsz/sizeof(struct elf32_rel); i++) {
+		switch(ELF32_R_TYPE(rel[i].r_info)) {
+			case R_ARM_NONE:
+				break;
+			case R_ARM_RELATIVE:
+				if(rel[i].r_offset < ent->start || rel[i].r_offset > ent->end - 4 ||
+					(rel[i].r_offset & 3)) {
+					return -1;
+				}
+				*(unsigned int *)(rel[i].r_offset + bias) += bias;
+				break;
+			default:
+				return -1;
+		}
+	}
+
+	return 0;
+}
+
+/* Map the pages of a parsed app to its addrs */
+static int exec_map(struct exec_cache_entry *ent, struct exec_image *img)
+{
+	struct exec_page *p;
+	unsigned int va;
+	char *page;
+
+	if(ent->direct) {
+		exec_copy_direct(ent, img, img->bias);
+		return ent->pie ? exec_relocate(ent, img->bias) : 0;
+	}
+
+	for(va=ent->start, p=ent->pages; va<ent->end; va+=PAGE_SIZE, p++) {
+		if(p->kind == EXEC_PAGE_NONE) {
+			continue;
+		}
+
+		if(p->kind == EXEC_PAGE_XIP) {
+			if(map_page(va, p->addr, PTE_AP_USER_RO)) {
+				return -1;
+			}
+			img->xip_pages++;
+		} else if(p->kind == EXEC_PAGE_SHARED) {
+			if(map_page(va, p->addr, PTE_AP_USER_RO)) {
+				return -1;
+			}
+			img->shared_pages++;
+		} else {
+			if((page = (char *)get_free_pages(0, 0)) == NULL) {
+				return -1;
+			}
+			if(p->addr) {
+				memcpy(page, (void *)p->addr, PAGE_SIZE);
+			} else {
+				memset(page, 0, PAGE_SIZE);
+			}
+			// Kernel memory is mapped 1:1
+			if(map_page(va, (unsigned int)page, PTE_AP_USER_RW)) {
+				put_free_pages(page, 0);
+				return -1;
+			}
+			img->copied_pages++;
+		}
+	}
+
+	return 0;
+}
+
+/* Reserve the pages of "img" for it
+ *
+ * Return value: 0 on success, -1 if they overlap those of a loaded app
+ */
+static int exec_reserve(struct exec_image *img)
+{
+	struct list_head *pos;
+	struct exec_image *p;
+	unsigned int flags;
+
+	flags = local_irq_save();
+	list_for_each(pos, &exec_images) {
+		p = list_entry(pos, struct exec_image, list);
+		if(p->start < img->end && p->end > img->start) {
+			local_irq_restore(flags);
+			return -1;
+		}
+	}
+	list_add(&img->list, &exec_images);
+	local_irq_restore(flags);
+
+	return 0;
+}
+
+/* Load ELF app "path" of file system "super" into memory
+ *
+ * @Parameters: "flags" is EXEC_XIP or 0; "img" gets the entry addr and how
+ *  the app has been loaded, and is in the list of loaded apps until
+ *  unload_elf().
+ *
+ * Return value: 0 on success, -1 on error
+ */
+int load_elf(struct super_block *super, char *path, unsigned int flags,
+			struct exec_image *img)
+{
+	struct exec_cache_entry *ent;
+	char *page = NULL;
+
+	if((ent = exec_cache_get(super, path, flags)) == NULL) {
+		return -1;
+	}
+
+	img->ent = ent;
+	img->bias = 0;
+	img->xip_pages = img->shared_pages = img->copied_pages = 0;
+
+	/// A PIE app goes to any free pages
+	if(ent->pie) {
+		if((page = (char *)get_free_pages(0, ent->order)) == NULL) {
+			exec_cache_put(ent);
+			return -1;
+		}
+		img->bias = (unsigned int)page - ent->start;
+	}
+	img->entry = ent->entry + img->bias;
+	img->start = ent->start + img->bias;
+	img->end = ent->end + img->bias;
+
+	if(exec_reserve(img)) {
+		if(ent->pie) {
+			put_free_pages(page, ent->order);
+		}
+		exec_cache_put(ent);
+		return -1;
+	}
+	if(exec_map(ent, img)) {
+		unload_elf(img);
+		return -1;
+	}
+
+	return 0;
+}
+
+/* Unmap the pages of a loaded app, free those that were allocated, and take
+ * it off the list of loaded apps
+ */
+void unload_elf(struct exec_image *img)
+{
+	unsigned int va, pte, flags;
+
+	/// Apps in memory mapped by sections were copied to their addrs
+	if(img->ent->pie) {
+		put_free_pages((void *)img->start, img->ent->order);
+	} else if(!img->ent->direct) {
+		for(va=img->start; va<img->end; va+=PAGE_SIZE) {
+			// Pages mapped read-only belong to the device or the cache; 
+			// writable ones were allocated
+			if((pte = unmap_page(va)) && PTE_L2_AP(pte) == PTE_AP_USER_RW) {
+				put_free_pages((void *)PTE_L2_PADDR(pte), 0);
+			}
+		}
+	}
+
+	flags = local_irq_save();
+	list_del(&img->list);
+	local_irq_restore(flags);
+
+	exec_cache_put(img->ent);
+}
+
+void exec_cache_get_stats(struct exec_cache_stats *stats)
+{
+	*stats = estats;
+}
+
+/* Unload the app run by process "tsk"; called when it exits */
+void exit_image(struct task_info *tsk)
+{
+	struct exec_image *img = tsk->image;
+
+	if(img) {
+		tsk->image = NULL;
+		unload_elf(img);
+		kfree(img);
+	}
+}
+
+/* System Call 11: run the ELF app "path" as a new process
+ *
+ * NOTE
+ * The new process is given its app with interrupts disabled, so it cannot
+ * run, and exit, before.
+ *
+ * Return value: the process ID, or -1
+ */
+int __syscall_spawn(const char *path)
+{
+	struct super_block *super;
+	struct exec_image *img;
+	struct task_info *tsk;
+	unsigned int flags;
+	char *name;
+	int pid;
+
+	if((super = vfs_lookup(path, &name)) == NULL || *name == '\0') {
+		return -1;
+	}
+	if((img = (struct exec_image *)kmalloc(sizeof(struct exec_image))) == NULL) {
+		return -1;
+	}
+	if(load_elf(super, name, EXEC_XIP, img)) {
+		kfree(img);
+		return -1;
+	}
+
+	flags = local_irq_save();
+	if((tsk = kernel_thread((int (*)(void *))img->entry, NULL)) == NULL) {
+		local_irq_restore(flags);
+		unload_elf(img);
+		kfree(img);
+		return -1;
+	}
+	tsk->image = img;
+	pid = tsk->pid;
+	local_irq_restore(flags);
+
+	return pid;
+}
+
+/* System Call 12: terminate the calling process */
+int __syscall_exit(int code)
+{
+	do_exit(code);
+
+	return 0;
+}
 
 /* Execute the application at memory addr "start" */
 int exec(unsigned int start)
 {
-	// According to "Procedure Call Standard for ARM Architecture", the 
-	// first parameter of a function is saved to register r0.  
+	// According to "Procedure Call Standard for ARM Architecture", the
+	// first parameter of a function is saved to register r0.
 	asm volatile (
-		"mov pc,r0\n\t" // set PC to the entry addr of an external app 
+		"mov pc,r0\n\t" // set PC to the entry addr of an external app
 	);
-	
+
 	return 0;
 }
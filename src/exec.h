@@ -0,0 +1,78 @@
+/* exec.h
+ * Loading apps and running them as processes
+ *
+ * NOTE
+ * 1. spawn() loads an ELF app from a file and runs it as a new process,
+ *    which runs "main" on a stack of its own, the process memory of
+ *    TASK_SIZE bytes. Returning from "main" is the same as calling exit().
+ * 2. Processes share one address space, so apps running at the same time
+ *    must be linked at different addrs; spawning an app whose pages overlap
+ *    those of a running app fails. Position-independent apps have no such
+ *    limit, as each one is copied to free pages and relocated.
+*/
+
+#ifndef EXEC_H
+#define EXEC_H
+
+#include "syscall.h"
+#include "fs.h"
+#include "util_list.h"
+
+
+/* ----------------- User-space helpers ------------------------ */
+
+/* Run the ELF app "path" as a new process
+ *
+ * Return value: the process ID, or -1
+ */
+static inline int spawn(const char *path)
+{
+	return syscall1(__NR_spawn, path);
+}
+
+/* Terminate the calling process */
+static inline void exit(int code)
+{
+	syscall1(__NR_exit, code);
+}
+
+
+/* ----------------- Kernel ------------------------ */
+
+/// Flags of load_elf()
+#define EXEC_XIP		0x1		// execute read-only segments in place
+
+#define EXEC_MAX_PHDRS	8
+
+struct exec_cache_entry;
+
+// A loaded app
+struct exec_image {
+	struct list_head list;      // in the list of loaded apps
+	struct exec_cache_entry *ent;   // the app parsed, see exec.c
+	unsigned int start;         // page-aligned range of all its segments
+	unsigned int end;
+	unsigned int entry;
+	unsigned int bias;          // load bias of a PIE app, 0 otherwise
+	unsigned int xip_pages;     // pages mapped in place from the device
+	unsigned int shared_pages;  // read-only pages mapped to the exec cache
+	unsigned int copied_pages;  // pages allocated and filled
+};
+
+struct exec_cache_stats {
+	unsigned int hits;
+	unsigned int misses;
+	unsigned int nr_entries;    // # of cached apps
+};
+
+struct task_info;
+
+int load_elf(struct super_block *super, char *path, unsigned int flags,
+			struct exec_image *img);
+void unload_elf(struct exec_image *img);
+void exit_image(struct task_info *tsk);
+void exec_cache_get_stats(struct exec_cache_stats *stats);
+int exec(unsigned int start);
+
+
+#endif // EXEC_H
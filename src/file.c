@@ -0,0 +1,367 @@
+/* file.c
+ * Open files and the system calls on them, see file.h
+ *
+ * NOTE
+ * 1. Descriptor tables are only used by their own processes, and are changed
+ *    with interrupts disabled, as a process may be preempted by the tick.
+ * 2. Processes and the kernel share one address space, so buffers and paths
+ *    passed in are used as they are.
+*/
+
+#include "file.h"
+#include "fs.h"
+#include "proc.h"
+#include "memory.h"
+#include "string.h"
+#include "interrupt.h"
+
+#define NULL ((void *)0)
+
+
+// Where file systems are in the path name space
+struct vfs_mount {
+	const char *dir;            // without the trailing '/', except for the root
+	unsigned int id;            // in fs_type[]
+};
+
+static const struct vfs_mount vfs_mounts[] = {
+	{ "/tmp", TMPFS },
+	{ "/zrom", ZROMFS },
+	{ "/",    ROMFS },
+};
+
+#define NR_MOUNTS	(sizeof(vfs_mounts)/sizeof(vfs_mounts[0]))
+
+/* Find the file system of "path"; "*name" is set to the path within it
+ *
+ * Return value: the super block, or NULL if "path" is not absolute or the
+ *  file system is not registered
+ */
+struct super_block *vfs_lookup(const char *path, char **name)
+{
+	const struct vfs_mount *best = NULL;
+	unsigned int i, len, best_len = 0;
+
+	if(path == NULL || path[0] != '/') {
+		return NULL;
+	}
+
+	for(i=0; i<NR_MOUNTS; i++) {
+		len = strlen(vfs_mounts[i].dir);
+		if(len == 1) {
+			// The root matches everything
+			len = 0;
+		} else if(strncmp(path, vfs_mounts[i].dir, len) ||
+				(path[len] != '/' && path[len] != '\0')) {
+			continue;
+		}
+		if(best == NULL || len > best_len) {
+			best = &vfs_mounts[i];
+			best_len = len;
+		}
+	}
+
+	path += best_len;
+	while(*path == '/') {
+		path++;
+	}
+	*name = (char *)path;
+
+	return fs_type[best->id];
+}
+
+/* Get the open file of descriptor "fd" of the current process */
+static struct file *fget(int fd)
+{
+	if(fd < 0 || fd >= NR_OPEN) {
+		return NULL;
+	}
+
+	return current->files[fd];
+}
+
+/* Drop a descriptor of an open file; the last one releases it */
+static void fput(struct file *filp)
+{
+	if(--filp->count == 0) {
+		if(filp->f_op->release) {
+			filp->f_op->release(filp);
+		}
+		kfree(filp);
+	}
+}
+
+/* ----------------- Readahead ------------------------ */
+
+/* Update the readahead window of "filp" for a read of "size" bytes at "pos",
+ * and read the next window ahead when the reader has got into the current one
+ *
+ * NOTE
+ * The first sequential read opens a window of FILE_RA_MIN_SIZE bytes (or the
+ * read size) starting at it. Once a read goes past the middle of the window,
+ * the following window, twice as large, is read ahead, so the data is in the
+ * cache before the reader gets there.
+ */
+static void file_readahead(struct file *filp, unsigned int pos, unsigned int size)
+{
+	struct file_ra_state *ra = &filp->ra;
+	struct inode *inode = filp->inode;
+	unsigned int end = pos + size;
+
+	if(inode->super->readahead == NULL) {
+		return;
+	}
+
+	if(pos != ra->prev_pos) {
+		/// Random access: no readahead until it is sequential again
+		ra->size = 0;
+	} else if(ra->size == 0) {
+		ra->start = pos;
+		ra->size = size > FILE_RA_MIN_SIZE ? size : FILE_RA_MIN_SIZE;
+		if(ra->size > FILE_RA_MAX_SIZE) {
+			ra->size = FILE_RA_MAX_SIZE;
+		}
+		inode->super->readahead(inode, ra->start, ra->size);
+	} else if(end > ra->start + ra->size/2) {
+		ra->start += ra->size;
+		if(ra->start < pos) {
+			ra->start = pos;
+		}
+		ra->size *= 2;
+		if(ra->size > FILE_RA_MAX_SIZE) {
+			ra->size = FILE_RA_MAX_SIZE;
+		}
+		inode->super->readahead(inode, ra->start, ra->size);
+	}
+
+	ra->prev_pos = end;
+}
+
+/* ----------------- Generic file operations ------------------------ */
+
+/* Read through "read" of the file system, with readahead */
+int generic_file_read(struct file *filp, void *buf, unsigned int size)
+{
+	struct inode *inode = filp->inode;
+	int n;
+
+	if(inode->super->read == NULL) {
+		return -1;
+	}
+	if(size == 0 || filp->pos >= inode->dsize) {
+		return 0;
+	}
+
+	file_readahead(filp, filp->pos, size);
+
+	if((n = inode->super->read(inode, buf, filp->pos, size)) > 0) {
+		filp->pos += n;
+	}
+
+	return n;
+}
+
+/* Write through "write" of the file system */
+int generic_file_write(struct file *filp, const void *buf, unsigned int size)
+{
+	struct inode *inode = filp->inode;
+	int n;
+
+	if(inode->super->write == NULL) {
+		return -1;
+	}
+
+	if((n = inode->super->write(inode, buf, filp->pos, size)) > 0) {
+		filp->pos += n;
+	}
+
+	return n;
+}
+
+/* Set the file position; it may be beyond the end of the file
+ *
+ * NOTE
+ * The position is returned as an int, so it must not go beyond 0x7fffffff;
+ * it is computed unsigned and checked, as an int sum would wrap around into
+ * a valid-looking position.
+ */
+int generic_file_lseek(struct file *filp, int offset, int whence)
+{
+	unsigned int base, pos;
+
+	switch(whence) {
+		case SEEK_SET:
+			base = 0;
+			break;
+		case SEEK_CUR:
+			base = filp->pos;
+			break;
+		case SEEK_END:
+			base = filp->inode->dsize;
+			break;
+		default:
+			return -1;
+	}
+	if(offset < 0) {
+		if(-(unsigned int)offset > base) {
+			return -1;
+		}
+		pos = base - -(unsigned int)offset;
+	} else {
+		pos = base + (unsigned int)offset;
+		if(pos < base) {
+			return -1;
+		}
+	}
+	if(pos > 0x7fffffff) {
+		return -1;
+	}
+	filp->pos = pos;
+
+	return pos;
+}
+
+void generic_file_release(struct file *filp)
+{
+	iput(filp->inode);
+}
+
+const struct file_operations generic_file_ops = {
+	.read = generic_file_read,
+	.write = generic_file_write,
+	.lseek = generic_file_lseek,
+	.release = generic_file_release,
+};
+
+/* ----------------- System calls ------------------------ */
+
+/* System Call 6: open file "path"
+ *
+ * NOTE
+ * With O_CREAT, a file that does not exist is created, if the file system
+ * supports it.
+ */
+int __syscall_open(const char *path, int flags)
+{
+	struct super_block *super;
+	struct inode *inode;
+	struct file *filp;
+	char *name;
+	unsigned int irq;
+	int fd;
+
+	if((super = vfs_lookup(path, &name)) == NULL || *name == '\0') {
+		return -1;
+	}
+
+	if((inode = super->namei(super, name)) == NULL) {
+		if(!(flags & O_CREAT) || super->create == NULL ||
+			(inode = super->create(super, name)) == NULL) {
+			return -1;
+		}
+	}
+	if((flags & O_ACCMODE) != O_RDONLY && super->write == NULL) {
+		goto ERR;
+	}
+
+	if((filp = (struct file *)kmalloc(sizeof(struct file))) == NULL) {
+		goto ERR;
+	}
+	filp->inode = inode;
+	filp->f_op = super->fops ? super->fops : &generic_file_ops;
+	filp->pos = 0;
+	filp->flags = flags;
+	filp->count = 1;
+	filp->ra.start = filp->ra.size = filp->ra.prev_pos = 0;
+
+	irq = local_irq_save();
+	for(fd=0; fd<NR_OPEN; fd++) {
+		if(current->files[fd] == NULL) {
+			current->files[fd] = filp;
+			local_irq_restore(irq);
+			return fd;
+		}
+	}
+	local_irq_restore(irq);
+
+	kfree(filp);
+ERR:
+	iput(inode);
+	return -1;
+}
+
+/* System Call 7: read "size" bytes from the file position of "fd" */
+int __syscall_read(int fd, void *buf, unsigned int size)
+{
+	struct file *filp;
+
+	if((filp = fget(fd)) == NULL || (filp->flags & O_ACCMODE) == O_WRONLY ||
+		filp->f_op->read == NULL) {
+		return -1;
+	}
+
+	return filp->f_op->read(filp, buf, size);
+}
+
+/* System Call 8: write "size" bytes at the file position of "fd" */
+int __syscall_write(int fd, const void *buf, unsigned int size)
+{
+	struct file *filp;
+
+	if((filp = fget(fd)) == NULL || (filp->flags & O_ACCMODE) == O_RDONLY ||
+		filp->f_op->write == NULL) {
+		return -1;
+	}
+
+	return filp->f_op->write(filp, buf, size);
+}
+
+/* System Call 9: set the file position of "fd" */
+int __syscall_lseek(int fd, int offset, int whence)
+{
+	struct file *filp;
+
+	if((filp = fget(fd)) == NULL || filp->f_op->lseek == NULL) {
+		return -1;
+	}
+
+	return filp->f_op->lseek(filp, offset, whence);
+}
+
+/* System Call 10: close "fd" */
+int __syscall_close(int fd)
+{
+	struct file *filp;
+	unsigned int irq;
+
+	irq = local_irq_save();
+	if((filp = fget(fd)) == NULL) {
+		local_irq_restore(irq);
+		return -1;
+	}
+	current->files[fd] = NULL;
+	local_irq_restore(irq);
+
+	fput(filp);
+
+	return 0;
+}
+
+/* Close all open files of process "tsk"; called when it exits */
+void exit_files(struct task_info *tsk)
+{
+	struct file *filp;
+	unsigned int irq;
+	int fd;
+
+	for(fd=0; fd<NR_OPEN; fd++) {
+		irq = local_irq_save();
+		filp = tsk->files[fd];
+		tsk->files[fd] = NULL;
+		local_irq_restore(irq);
+
+		if(filp) {
+			fput(filp);
+		}
+	}
+}
@@ -0,0 +1,116 @@
+/* file.h
+ * Open files and the system calls on them
+ *
+ * NOTE
+ * 1. A process refers to an open file by a descriptor, an index into the
+ *    "files" table in its "struct task_info". Each "struct file" holds the
+ *    inode, the file position and the readahead state, and works through the
+ *    "file_operations" of its file system.
+ * 2. Paths are absolute. The file system of a path is found in the mount
+ *    table of file.c by the longest matching directory; e.g., "/tmp/log" is
+ *    "log" in tmpfs, "/zrom/app1.elf" is "app1.elf" in zromfs and 
+ *    "/app2.elf" is "app2.elf" in romfs.
+ * 3. Reads of a file that are sequential open a readahead window, which
+ *    doubles each time the reader gets into it, up to FILE_RA_MAX_SIZE; a
+ *    read anywhere else closes it again.
+*/
+
+#ifndef FILE_H
+#define FILE_H
+
+#include "syscall.h"
+
+
+/// Flags of open()
+#define O_RDONLY	0x0
+#define O_WRONLY	0x1
+#define O_RDWR		0x2
+#define O_ACCMODE	0x3
+#define O_CREAT		0x40
+
+/// "whence" of lseek()
+#define SEEK_SET	0
+#define SEEK_CUR	1
+#define SEEK_END	2
+
+#define FILE_RA_MIN_SIZE	(2*1024)	// bytes
+#define FILE_RA_MAX_SIZE	(16*1024)
+
+
+/* ----------------- User-space helpers ------------------------ */
+
+/* Open file "path"
+ *
+ * Return value: the file descriptor, or -1
+ */
+static inline int open(const char *path, int flags)
+{
+	return syscall2(__NR_open, path, flags);
+}
+
+/* Return value: # of bytes read, 0 at the end of the file, or -1 */
+static inline int read(int fd, void *buf, unsigned int size)
+{
+	return syscall3(__NR_read, fd, buf, size);
+}
+
+/* Return value: # of bytes written, or -1 */
+static inline int write(int fd, const void *buf, unsigned int size)
+{
+	return syscall3(__NR_write, fd, buf, size);
+}
+
+/* Return value: the new file position, or -1 */
+static inline int lseek(int fd, int offset, int whence)
+{
+	return syscall3(__NR_lseek, fd, offset, whence);
+}
+
+static inline int close(int fd)
+{
+	return syscall1(__NR_close, fd);
+}
+
+
+/* ----------------- Kernel ------------------------ */
+
+struct inode;
+struct file;
+struct super_block;
+struct task_info;
+
+struct file_operations {
+	int (*read)(struct file *filp, void *buf, unsigned int size);
+	int (*write)(struct file *filp, const void *buf, unsigned int size);
+	int (*lseek)(struct file *filp, int offset, int whence);
+	// Called when the last descriptor of the file is closed
+	void (*release)(struct file *filp);
+};
+
+// Readahead state of an open file
+struct file_ra_state {
+	unsigned int start;         // file offset of the current window
+	unsigned int size;          // size of the window; 0 when not sequential
+	unsigned int prev_pos;      // where the previous read ended
+};
+
+struct file {
+	struct inode *inode;
+	const struct file_operations *f_op;
+	unsigned int pos;
+	unsigned int flags;         // of open()
+	int count;                  // # of descriptors
+	struct file_ra_state ra;
+};
+
+extern const struct file_operations generic_file_ops;
+
+int generic_file_read(struct file *filp, void *buf, unsigned int size);
+int generic_file_write(struct file *filp, const void *buf, unsigned int size);
+int generic_file_lseek(struct file *filp, int offset, int whence);
+void generic_file_release(struct file *filp);
+struct super_block *vfs_lookup(const char *path, char **name);
+void exit_files(struct task_info *tsk);
+
+
+#endif // FILE_H
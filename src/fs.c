@@ -2,6 +2,10 @@
 
 #include "fs.h"
 #include "string.h"
+#include "memory.h"
+#include "interrupt.h"
+#include "proc.h"
+#include "initcall.h"
 
 
 #define NULL (void *)0
@@ -25,3 +29,206 @@ void unregister_file_system(struct super_block *type, unsigned int id)
 	fs_type[id] = NULL;
 }
 
+
+/* ----------------- Inode cache ------------------------ */
+
+/* NOTE
+ * 1. Inodes are looked up by (super block, ino) through a hash table.
+ *    iget_locked() either returns a cached inode with one more user, or a
+ *    new one in state I_NEW, which the file system fills in before calling
+ *    unlock_new_inode(). Others who find an I_NEW inode wait until then.
+ * 2. iput() drops a user; an inode without users stays cached in LRU order,
+ *    and the least recently used ones are freed once there are more than
+ *    ICACHE_MAX_UNUSED of them.
+ * 3. Inodes that a file system keeps by itself, e.g., those of tmpfs, are
+ *    not in the cache; iput() hands them back to its put_inode(), if any.
+ * 4. "name" of a cached inode belongs to the file system and is not freed 
+ *    with the inode.
+ */
+
+#define ICACHE_HASH_SIZE	64		// a power of 2
+#define ICACHE_MAX_UNUSED	32
+
+#define icache_hashfn(super,ino) \
+	((((unsigned int)(super)>>4) ^ (ino) ^ ((ino)>>8)) & (ICACHE_HASH_SIZE-1))
+
+static struct kmem_cache inode_cachep;
+static struct list_head inode_hash[ICACHE_HASH_SIZE];
+static struct list_head inode_unused;
+static struct icache_stats istats;
+
+/* Initialize the inode cache */
+int __init icache_init(void)
+{
+	int i;
+
+	for(i=0; i<ICACHE_HASH_SIZE; i++) {
+		INIT_LIST_HEAD(&inode_hash[i]);
+	}
+	INIT_LIST_HEAD(&inode_unused);
+
+	if(kmem_cache_create(&inode_cachep, sizeof(struct inode), 0) == NULL) {
+		return -1;
+	}
+
+	return 0;
+}
+subsys_initcall(icache_init);
+
+/* Free an unused inode; called with interrupts disabled */
+static void destroy_inode(struct inode *inode)
+{
+	list_del(&inode->hash);
+	istats.nr_inodes--;
+	kmem_cache_free(&inode_cachep, inode);
+}
+
+/* Free the least recently used inodes beyond ICACHE_MAX_UNUSED */
+static void prune_icache(void)
+{
+	struct inode *inode;
+
+	while(istats.nr_unused > ICACHE_MAX_UNUSED) {
+		inode = list_entry(inode_unused.next, struct inode, lru);
+		list_del_init(&inode->lru);
+		istats.nr_unused--;
+		destroy_inode(inode);
+	}
+}
+
+static struct inode *find_inode(struct super_block *super, unsigned int ino)
+{
+	struct list_head *pos;
+	struct inode *inode;
+
+	list_for_each(pos, &inode_hash[icache_hashfn(super, ino)]) {
+		inode = list_entry(pos, struct inode, hash);
+		if(inode->super == super && inode->ino == ino) {
+			return inode;
+		}
+	}
+
+	return NULL;
+}
+
+/* Get inode "ino" of file system "super", with one more user
+ *
+ * Return value: the cached inode; a new inode in state I_NEW if it is not
+ *  cached; NULL if no memory is left
+ */
+struct inode *iget_locked(struct super_block *super, unsigned int ino)
+{
+	struct inode *inode;
+	unsigned int flags;
+
+	flags = local_irq_save();
+
+	if((inode = find_inode(super, ino))) {
+		if(inode->count++ == 0) {
+			list_del_init(&inode->lru);
+			istats.nr_unused--;
+		}
+		istats.hits++;
+		local_irq_restore(flags);
+
+		while(inode->state & I_NEW) {
+			schedule();
+		}
+		// Filling it in failed
+		if(!(inode->state & I_CACHED)) {
+			iget_failed(inode);
+			return NULL;
+		}
+
+		return inode;
+	}
+
+	if((inode = (struct inode *)kmem_cache_alloc(&inode_cachep, 0)) == NULL) {
+		local_irq_restore(flags);
+		return NULL;
+	}
+	memset(inode, 0, sizeof(struct inode));
+	inode->super = super;
+	inode->ino = ino;
+	inode->count = 1;
+	inode->state = I_NEW | I_CACHED;
+	INIT_LIST_HEAD(&inode->lru);
+	list_add(&inode->hash, &inode_hash[icache_hashfn(super, ino)]);
+	istats.misses++;
+	istats.nr_inodes++;
+
+	local_irq_restore(flags);
+
+	return inode;
+}
+
+/* The new inode got by iget_locked() has been filled in */
+void unlock_new_inode(struct inode *inode)
+{
+	inode->state &= ~I_NEW;
+}
+
+/* The new inode got by iget_locked() cannot be filled in; drop it
+ *
+ * NOTE
+ * Waiters that found it meanwhile see it is no longer I_CACHED, and drop 
+ * their references the same way; the last one frees it.
+ */
+void iget_failed(struct inode *inode)
+{
+	unsigned int flags;
+
+	flags = local_irq_save();
+	if(inode->state & I_CACHED) {
+		list_del_init(&inode->hash);
+		inode->state = 0;
+	}
+	if(--inode->count == 0) {
+		istats.nr_inodes--;
+		kmem_cache_free(&inode_cachep, inode);
+	}
+	local_irq_restore(flags);
+}
+
+/* Get one more user of an inode that is in use */
+struct inode *igrab(struct inode *inode)
+{
+	unsigned int flags;
+
+	if(inode->state & I_CACHED) {
+		flags = local_irq_save();
+		inode->count++;
+		local_irq_restore(flags);
+	}
+
+	return inode;
+}
+
+/* Drop a user of an inode */
+void iput(struct inode *inode)
+{
+	unsigned int flags;
+
+	if(inode == NULL) {
+		return;
+	}
+	if(!(inode->state & I_CACHED)) {
+		if(inode->super->put_inode) {
+			inode->super->put_inode(inode);
+		}
+		return;
+	}
+
+	flags = local_irq_save();
+	if(--inode->count == 0) {
+		list_add_tail(&inode->lru, &inode_unused);
+		istats.nr_unused++;
+		prune_icache();
+	}
+	local_irq_restore(flags);
+}
+
+void icache_get_stats(struct icache_stats *stats)
+{
+	*stats = istats;
+}
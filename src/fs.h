@@ -5,11 +5,14 @@
 
 
 #include "storage.h"
+#include "util_list.h"
 
 // Maximum # of file system types that can be registered into the system 
 #define MAX_SUPER_BLOCK	8
 /// IDs of each file system type
 #define ROMFS	0
+#define TMPFS	1
+#define ZROMFS	2
 
 // Index node
 struct inode {
@@ -19,22 +22,72 @@ struct inode {
 	unsigned int daddr;	   // file data addr in the device
 	// Data and operations related to a specific file system
 	struct super_block *super; 
+
+	/// Inode cache, see fs.c
+	unsigned int ino;      // unique in the file system, e.g., a header offset
+	int count;             // # of users
+	volatile unsigned int state;
+	struct list_head hash;
+	struct list_head lru;  // in the LRU list while unused
+};
+
+/// States of inodes
+#define I_NEW		0x1		// being filled in by the file system
+#define I_CACHED	0x2		// got from iget_locked(), i.e., in the inode cache
+
+struct icache_stats {
+	unsigned int hits;
+	unsigned int misses;
+	unsigned int nr_inodes;     // # of cached inodes
+	unsigned int nr_unused;     // # of cached inodes with no users
 };
 
+struct file_operations;
+
 // Data and operations related to a specific file system
+// NOTE  Operations a file system does not support are NULL
 struct super_block {
 	// Pointer to a function that gets the inode of a file based on the file name	
 	struct inode *(*namei)(struct super_block *super,char *p);
 	// Given a file's inode, get the file's addr in the device			
 	unsigned int (*get_daddr)(struct inode *);
+	// Create a file, or get it if it exists
+	struct inode *(*create)(struct super_block *super, char *name);
+	// Remove a file
+	int (*unlink)(struct super_block *super, char *name);
+	/// Read/write "size" bytes at offset "pos" of a file; return the # of 
+	/// bytes done, or -1
+	int (*read)(struct inode *node, void *buf, unsigned int pos, size_t size);
+	int (*write)(struct inode *node, const void *buf, unsigned int pos, size_t size);
+	// Get the memory page holding page "index" of a file, for file systems 
+	// that keep data in memory; the page is allocated if "create" is not 0
+	void *(*get_page)(struct inode *node, unsigned int index, int create);
+	// Start reading "size" bytes at offset "pos" of a file into the cache, 
+	// without waiting for them
+	void (*readahead)(struct inode *node, unsigned int pos, size_t size);
+	// Drop a user of an inode kept by the file system itself, see iput()
+	void (*put_inode)(struct inode *node);
+	// Operations on open files; generic_file_ops if NULL
+	const struct file_operations *fops;
 	// storage device that the file system resides on
 	struct storage_device *device;
 	// name of file system type 
 	char *name; 
 };
 
-// All file system types registered into the system 
-struct super_block *fs_type[MAX_SUPER_BLOCK];
+// All file system types registered into the system; defined in fs.c 
+extern struct super_block *fs_type[MAX_SUPER_BLOCK];
+
+int register_file_system(struct super_block *type, unsigned int id);
+void unregister_file_system(struct super_block *type, unsigned int id);
+
+int icache_init(void);
+struct inode *iget_locked(struct super_block *super, unsigned int ino);
+void unlock_new_inode(struct inode *inode);
+void iget_failed(struct inode *inode);
+struct inode *igrab(struct inode *inode);
+void iput(struct inode *inode);
+void icache_get_stats(struct icache_stats *stats);
 
 
 #endif // FS_H
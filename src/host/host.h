@@ -0,0 +1,35 @@
+/* host.h
+ * Host build of romfs, the inode cache, print and string code, see Makefile
+ *
+ * NOTE
+ * 1. Kernel sources are compiled as they are, with CONFIG_HOST defined, and
+ *    linked with host_kernel.c, which stands in for the parts of the kernel
+ *    that need the target: allocators, interrupts, the scheduler, the UART
+ *    and the buffer cache. The ramdisk is a romfs image file read into host
+ *    memory.
+ * 2. Kernel headers define types of their own, e.g., size_t, which clash
+ *    with those of the C library, so no file includes both. host_io.c only
+ *    uses the C library, and what it provides is declared here with plain
+ *    types.
+*/
+
+#ifndef HOST_H
+#define HOST_H
+
+
+/// host_io.c
+void *host_alloc(unsigned long size);
+void host_free(void *p);
+// Read a whole file into memory got from host_alloc(); NULL on error
+char *host_read_file(const char *path, unsigned int *size);
+int host_memcmp(const void *s1, const void *s2, unsigned int n);
+void host_write(const char *buf, unsigned int count);
+unsigned long long host_time_ns(void);
+void host_exit(int code);
+
+/// host_kernel.c
+// Register a romfs image file as the ramdisk
+int host_ramdisk_init(const char *path);
+
+
+#endif // HOST_H
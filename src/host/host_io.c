@@ -0,0 +1,73 @@
+/* host_io.c
+ * The C library of the host, see host.h
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "host.h"
+
+void *host_alloc(unsigned long size)
+{
+	return malloc(size);
+}
+
+void host_free(void *p)
+{
+	free(p);
+}
+
+char *host_read_file(const char *path, unsigned int *size)
+{
+	FILE *f;
+	char *buf = NULL;
+	long n;
+
+	if((f = fopen(path, "rb")) == NULL) {
+		return NULL;
+	}
+	if(fseek(f, 0, SEEK_END) || (n = ftell(f)) <= 0 || fseek(f, 0, SEEK_SET)) {
+		goto OUT;
+	}
+	if((buf = malloc(n)) == NULL) {
+		goto OUT;
+	}
+	if(fread(buf, 1, n, f) != (size_t)n) {
+		free(buf);
+		buf = NULL;
+		goto OUT;
+	}
+	*size = n;
+
+OUT:
+	fclose(f);
+	return buf;
+}
+
+int host_memcmp(const void *s1, const void *s2, unsigned int n)
+{
+	return memcmp(s1, s2, n);
+}
+
+void host_write(const char *buf, unsigned int count)
+{
+	fwrite(buf, 1, count, stdout);
+}
+
+unsigned long long host_time_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void host_exit(int code)
+{
+	fflush(stdout);
+	exit(code);
+}
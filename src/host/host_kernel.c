@@ -0,0 +1,142 @@
+/* host_kernel.c
+ * Stand-ins for the parts of the kernel that need the target, see host.h
+ *
+ * NOTE
+ * 1. There is one process and no interrupts, so disabling interrupts and
+ *    scheduling do nothing.
+ * 2. The slab caches and kmalloc() are malloc(), so that host tools, e.g.,
+ *    valgrind, see every allocation.
+ * 3. Reads through the buffer cache go to the device directly, so lookups
+ *    and reads are timed without the cache, which is measured on the target
+ *    by bench.c.
+*/
+
+#include "storage.h"
+#include "memory.h"
+#include "string.h"
+#include "interrupt.h"
+#include "uart.h"
+#include "bcache.h"
+#include "host.h"
+
+#define NULL ((void *)0)
+
+// Like the ramdisk, the device is larger than the image, and zero-filled
+#define HOST_RAMDISK_ALIGN		(64*1024)
+#define HOST_RAMDISK_SECTOR_SIZE	512
+
+
+/* ----------------- Allocators ------------------------ */
+
+void *kmalloc(unsigned int size)
+{
+	if(size == 0 || size >= KMALLOC_MAX_SIZE) {
+		return NULL;
+	}
+
+	return host_alloc(size);
+}
+
+void kfree(void *addr)
+{
+	host_free(addr);
+}
+
+struct kmem_cache *kmem_cache_create(struct kmem_cache *cache,
+					unsigned int size, unsigned int flags)
+{
+	cache->obj_size = size;
+	cache->flags = flags;
+
+	return cache;
+}
+
+void kmem_cache_destroy(struct kmem_cache *cache)
+{
+}
+
+void *kmem_cache_alloc(struct kmem_cache *cache, unsigned int flag)
+{
+	return host_alloc(cache->obj_size);
+}
+
+void kmem_cache_free(struct kmem_cache *cache, void *objp)
+{
+	host_free(objp);
+}
+
+/* ----------------- Interrupts, processes and the UART ------------------------ */
+
+unsigned int local_irq_save(void)
+{
+	return 0;
+}
+
+void local_irq_restore(unsigned int flags)
+{
+}
+
+void schedule(void)
+{
+}
+
+int uart_write(const char *buf, unsigned int count)
+{
+	host_write(buf, count);
+
+	return count;
+}
+
+/* ----------------- Buffer cache and the ramdisk ------------------------ */
+
+int bcache_read(struct storage_device *sd, void *dest, unsigned int pos, size_t size)
+{
+	return sd->dout(sd, dest, pos, size);
+}
+
+int bcache_readahead(struct storage_device *sd, unsigned int pos, size_t size)
+{
+	return 0;
+}
+
+// Host addr of the device data; "start_pos" is only 32 bits
+static char *host_ramdisk_data;
+
+static int host_ramdisk_dout(struct storage_device *sd, void *dest,
+				unsigned int bias, size_t size)
+{
+	if(bias >= sd->storage_size || size > sd->storage_size - bias) {
+		return -1;
+	}
+	memcpy(dest, host_ramdisk_data + bias, size);
+
+	return 0;
+}
+
+static struct storage_device host_ramdisk_device = {
+	.sector_size = HOST_RAMDISK_SECTOR_SIZE,
+	.dout = host_ramdisk_dout,
+};
+
+int host_ramdisk_init(const char *path)
+{
+	unsigned int size, dev_size;
+	char *image;
+
+	if((image = host_read_file(path, &size)) == NULL) {
+		return -1;
+	}
+
+	dev_size = (size + HOST_RAMDISK_ALIGN) & ~(HOST_RAMDISK_ALIGN-1);
+	if((host_ramdisk_data = (char *)host_alloc(dev_size)) == NULL) {
+		host_free(image);
+		return -1;
+	}
+	memcpy(host_ramdisk_data, image, size);
+	memset(host_ramdisk_data + size, 0, dev_size - size);
+	host_free(image);
+
+	host_ramdisk_device.storage_size = dev_size;
+
+	return register_storage_device(&host_ramdisk_device, RAMDISK);
+}
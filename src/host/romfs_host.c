@@ -0,0 +1,264 @@
+/* romfs_host.c
+ * Host harness of romfs, print and string code on a real romfs image
+ *
+ * Usage: romfs_host [-n <iters>] <image> <dir> <path>...
+ *
+ * NOTE
+ * 1. <image> is made by genromfs from <dir>, and each <path> is a file in
+ *    it, e.g., "a/b/c.txt". Every path is looked up with and without a
+ *    leading '/', its data is compared with that of the file in <dir>, and a
+ *    path under it must not be found. One line is printed per path:
+ *        HOST namei <path> ok size=<n>
+ *    or "FAIL" with the reason; the exit status is the # of failures.
+ * 2. Then the lookups, reads and formatting are timed, and printed in the
+ *    format of bench.c:
+ *        BENCH <name> iters=<n> ns_per_op=<n>
+ * 3. memcpy(), memset(), strlen() and strcmp() are in ARM assembly on the
+ *    target (string.s), so they come from the C library here; the inline
+ *    routines of string.h are the kernel's own.
+*/
+
+#include "fs.h"
+#include "string.h"
+#include "print.h"
+#include "host.h"
+
+#define NULL ((void *)0)
+
+#define HOST_DEFAULT_ITERS	100000
+#define HOST_MAX_PATH		256
+
+int icache_init(void);
+int romfs_init(void);
+
+// Results of the timed loops go here, so they are not optimized out
+static volatile unsigned int host_sink;
+
+static unsigned int host_atoi(const char *s)
+{
+	unsigned int n = 0;
+
+	while(*s >= '0' && *s <= '9') {
+		n = n*10 + *s++ - '0';
+	}
+
+	return n;
+}
+
+static void host_report(const char *name, unsigned int iters, unsigned long long ns)
+{
+	printk("BENCH %s iters=%u ns_per_op=%u\n", name, iters, (unsigned int)(ns / iters));
+}
+
+/* Check the lookup and the data of file "path" of the image against file
+ * "dir/path" of the host
+ *
+ * Return value: 0 if all is right, -1 otherwise
+ */
+static int host_check_path(struct super_block *super, const char *dir, char *path)
+{
+	char buf[HOST_MAX_PATH];
+	struct inode *node, *node2;
+	char *expect, *data = NULL;
+	unsigned int size;
+	int ret = -1;
+
+	snprintf(buf, sizeof(buf), "%s/%s", dir, path);
+	if((expect = host_read_file(buf, &size)) == NULL) {
+		// Not a regular file, or empty
+		size = 0;
+	}
+
+	if((node = super->namei(super, path)) == NULL) {
+		printk("HOST namei %s FAIL not found\n", path);
+		goto OUT;
+	}
+
+	snprintf(buf, sizeof(buf), "/%s", path);
+	node2 = super->namei(super, buf);
+	if(node2 != node) {
+		printk("HOST namei %s FAIL \"%s\" is another inode\n", path, buf);
+		iput(node2);
+		goto PUT;
+	}
+	iput(node2);
+
+	if(node->dsize != size) {
+		printk("HOST namei %s FAIL size=%u, %u expected\n", path, node->dsize, size);
+		goto PUT;
+	}
+	if(size && ((data = (char *)host_alloc(size)) == NULL ||
+			super->read(node, data, 0, size) != (int)size ||
+			host_memcmp(data, expect, size))) {
+		printk("HOST namei %s FAIL data differs\n", path);
+		goto PUT;
+	}
+
+	snprintf(buf, sizeof(buf), "%s/no-such-file", path);
+	if((node2 = super->namei(super, buf))) {
+		printk("HOST namei %s FAIL \"%s\" found\n", path, buf);
+		iput(node2);
+		goto PUT;
+	}
+
+	printk("HOST namei %s ok size=%u\n", path, size);
+	ret = 0;
+
+PUT:
+	iput(node);
+OUT:
+	host_free(data);
+	host_free(expect);
+	return ret;
+}
+
+/* Lookups of all the paths, and of paths that do not exist */
+static void host_bench_namei(struct super_block *super, char **paths, int nr,
+				unsigned int iters)
+{
+	unsigned long long t0, t1;
+	struct inode *node;
+	unsigned int i;
+
+	t0 = host_time_ns();
+	for(i=0; i<iters; i++) {
+		if((node = super->namei(super, paths[i % nr]))) {
+			iput(node);
+		}
+	}
+	t1 = host_time_ns();
+	host_report("romfs_namei", iters, t1 - t0);
+
+	t0 = host_time_ns();
+	for(i=0; i<iters; i++) {
+		host_sink += super->namei(super, "no/such/file") == NULL;
+	}
+	t1 = host_time_ns();
+	host_report("romfs_namei_miss", iters, t1 - t0);
+}
+
+/* Reads of 4KB from the start of the largest file of the paths */
+static void host_bench_read(struct super_block *super, char **paths, int nr,
+				unsigned int iters)
+{
+	unsigned long long t0, t1;
+	struct inode *node, *largest = NULL;
+	char *buf;
+	unsigned int i;
+
+	for(i=0; i<nr; i++) {
+		if((node = super->namei(super, paths[i])) == NULL) {
+			continue;
+		}
+		if(largest == NULL || node->dsize > largest->dsize) {
+			iput(largest);
+			largest = node;
+		} else {
+			iput(node);
+		}
+	}
+	if(largest == NULL) {
+		return;
+	}
+	if((buf = (char *)host_alloc(4096)) == NULL) {
+		iput(largest);
+		return;
+	}
+
+	t0 = host_time_ns();
+	for(i=0; i<iters; i++) {
+		host_sink += super->read(largest, buf, 0, 4096);
+	}
+	t1 = host_time_ns();
+	host_report("romfs_read_4096", iters, t1 - t0);
+
+	host_free(buf);
+	iput(largest);
+}
+
+/* Formatting by vsnprintf(), through snprintf() */
+static void host_bench_format(unsigned int iters)
+{
+	unsigned long long t0, t1;
+	char buf[128];
+	unsigned int i;
+
+	t0 = host_time_ns();
+	for(i=0; i<iters; i++) {
+		host_sink += snprintf(buf, sizeof(buf), "%u", i);
+	}
+	t1 = host_time_ns();
+	host_report("snprintf_uint", iters, t1 - t0);
+
+	t0 = host_time_ns();
+	for(i=0; i<iters; i++) {
+		host_sink += snprintf(buf, sizeof(buf), "%s: %d %08x %-8.3s|%5c|%p",
+				"sched", -(int)i, i, "romfs", 'x', buf);
+	}
+	t1 = host_time_ns();
+	host_report("snprintf_mixed", iters, t1 - t0);
+}
+
+/* The inline routines of string.h on the paths */
+static void host_bench_string(char **paths, int nr, unsigned int iters)
+{
+	unsigned long long t0, t1;
+	char buf[HOST_MAX_PATH];
+	unsigned int i;
+
+	t0 = host_time_ns();
+	for(i=0; i<iters; i++) {
+		strncpy(buf, paths[i % nr], sizeof(buf)-1);
+		host_sink += strncmp(buf, paths[(i+1) % nr], sizeof(buf));
+	}
+	t1 = host_time_ns();
+	host_report("strncpy_strncmp", iters, t1 - t0);
+
+	t0 = host_time_ns();
+	for(i=0; i<iters; i++) {
+		host_sink += strchr(paths[i % nr], '\0') - paths[i % nr];
+	}
+	t1 = host_time_ns();
+	host_report("strchr", iters, t1 - t0);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int iters = HOST_DEFAULT_ITERS;
+	struct super_block *super;
+	int i, failed = 0;
+
+	if(argc > 2 && !strcmp(argv[1], "-n")) {
+		iters = host_atoi(argv[2]);
+		argc -= 2;
+		argv += 2;
+	}
+	if(argc < 4 || iters == 0) {
+		printk("Usage: romfs_host [-n <iters>] <image> <dir> <path>...\n");
+		host_exit(-1);
+	}
+
+	if(host_ramdisk_init(argv[1])) {
+		printk("Error: cannot read %s\n", argv[1]);
+		host_exit(-1);
+	}
+	icache_init();
+	romfs_init();
+	super = fs_type[ROMFS];
+
+	for(i=3; i<argc; i++) {
+		if(host_check_path(super, argv[2], argv[i])) {
+			failed++;
+		}
+	}
+
+	printk("BENCH BEGIN host\n");
+	host_bench_namei(super, argv+3, argc-3, iters);
+	host_bench_read(super, argv+3, argc-3, iters/10 ? iters/10 : 1);
+	host_bench_format(iters);
+	host_bench_string(argv+3, argc-3, iters);
+	printk("BENCH END\n");
+
+	host_exit(failed);
+	return failed;
+}
@@ -0,0 +1,102 @@
+/* initcall.c
+ * Running the init functions registered with *_initcall(), see initcall.h
+ *
+ * NOTE
+ * 1. Every init function is timed with the clocksource, and a breakdown of 
+ *    the boot time by function and level is printed. Things done before 
+ *    timer_init(), e.g., turning the MMU on, are not timed.
+ * 2. Deferred init functions are run by a kernel thread, so that they do not
+ *    delay the first user process; they must not be needed by it.
+ * 3. The init section, i.e., the __init code and the "struct initcall"s, is
+ *    freed by that thread once all init functions have run.
+*/
+
+#include "initcall.h"
+#include "timer.h"
+#include "proc.h"
+#include "memory.h"
+#include "print.h"
+
+#define NULL ((void *)0)
+
+/// Defined in kernel.lds
+extern const struct initcall __initcall_start[], __initcall_end[];
+
+static const char *initcall_level_names[NR_INITCALL_LEVELS] = {
+	"core", "subsys", "device", "fs", "late", "deferred",
+};
+
+static unsigned int cycles_to_us(unsigned long long cycles)
+{
+	return (unsigned int)(cycles_to_ns(cycles) / NSEC_PER_USEC);
+}
+
+/* Run the init functions of levels from "from" to "to"; print how long each
+ * one and each level takes
+ *
+ * Return value: # of us they take in all
+ */
+static unsigned int __init run_initcalls(unsigned int from, unsigned int to)
+{
+	const struct initcall *call;
+	unsigned long long t0, t1, level_cycles[NR_INITCALL_LEVELS] = { 0 };
+	unsigned int level, total = 0;
+	int ret;
+
+	for(call=__initcall_start; call<__initcall_end; call++) {
+		if(call->level < from || call->level > to) {
+			continue;
+		}
+
+		t0 = clocksource_cycles();
+		ret = call->fn();
+		t1 = clocksource_cycles();
+
+		level_cycles[call->level] += t1 - t0;
+		printk("initcall: %-20s %8u us%s\n", call->name, cycles_to_us(t1 - t0),
+			ret ? " failed" : "");
+	}
+
+	for(level=from; level<=to; level++) {
+		if(level_cycles[level]) {
+			printk("initcall: level %-14s %8u us\n", initcall_level_names[level],
+				cycles_to_us(level_cycles[level]));
+			total += cycles_to_us(level_cycles[level]);
+		}
+	}
+
+	return total;
+}
+
+/* Run all init functions that are not deferred; called by plat_boot() */
+void __init do_initcalls(void)
+{
+	unsigned int us;
+
+	us = run_initcalls(INITCALL_CORE, INITCALL_LATE);
+	printk("initcall: %u us in all, %u us since the clocksource started\n", 
+		us, (unsigned int)(ktime_get_ns() / NSEC_PER_USEC));
+}
+
+static int deferred_initcalls_thread(void *unused)
+{
+	unsigned int us;
+
+	us = run_initcalls(INITCALL_DEFERRED, INITCALL_DEFERRED);
+	printk("initcall: %u us in deferred init functions\n", us);
+
+	/// No init code runs from now on
+	free_initmem();
+
+	// Returning exits the thread
+	return 0;
+}
+
+/* Run the deferred init functions in the background */
+void start_deferred_initcalls(void)
+{
+	if(kernel_thread(deferred_initcalls_thread, NULL) == NULL) {
+		printk("initcall: no thread; running deferred init functions now\n");
+		deferred_initcalls_thread(NULL);
+	}
+}
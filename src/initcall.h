@@ -0,0 +1,61 @@
+/* initcall.h
+ * Init functions run at boot by level, see initcall.c
+ *
+ * NOTE
+ * An init function is registered next to its definition, e.g.,
+ *     int romfs_init(void) { ... }
+ *     fs_initcall(romfs_init);
+ * which puts a "struct initcall" into section ".initcall<level>.init". The 
+ * linker script gathers these sections in level order between 
+ * "__initcall_start" and "__initcall_end", so no list is kept by hand. 
+ * Within a level, init functions run in link order, i.e., the order of 
+ * "kernel_objs" in the Makefile. The compiler may emit the ones of a file in
+ * any order, so init functions of a file that depend on each other must be 
+ * at different levels.
+ * Code only run at boot, e.g., the init functions themselves, is marked 
+ * __init; it goes to the init section at the end of the kernel (kernel.lds),
+ * together with the "struct initcall"s, which is freed once the deferred 
+ * init functions have run.
+*/
+
+#ifndef INITCALL_H
+#define INITCALL_H
+
+/// Levels; each needs the ones before it
+#define INITCALL_CORE		0	// the page allocator
+#define INITCALL_SUBSYS		1	// kmalloc(), caches and other subsystems
+#define INITCALL_DEVICE		2	// device drivers
+#define INITCALL_FS			3	// file systems
+#define INITCALL_LATE		4
+#define INITCALL_DEFERRED	5	// run by a kernel thread once processes run
+#define NR_INITCALL_LEVELS	6
+
+// Code only run at boot
+#define __init	__attribute__((section(".init.text")))
+
+typedef int (*initcall_t)(void);
+
+struct initcall {
+	initcall_t fn;
+	const char *name;
+	unsigned int level;
+};
+
+#define __define_initcall(fn, level) \
+	static const struct initcall __initcall_##fn \
+	__attribute__((used, section(".initcall" #level ".init"), aligned(4))) = \
+	{ fn, #fn, level }
+
+#define core_initcall(fn)		__define_initcall(fn, 0)
+#define subsys_initcall(fn)		__define_initcall(fn, 1)
+#define device_initcall(fn)		__define_initcall(fn, 2)
+#define fs_initcall(fn)			__define_initcall(fn, 3)
+#define late_initcall(fn)		__define_initcall(fn, 4)
+// Not needed by the first user process; run in the background
+#define deferred_initcall(fn)	__define_initcall(fn, 5)
+
+void do_initcalls(void);
+void start_deferred_initcalls(void);
+
+
+#endif // INITCALL_H
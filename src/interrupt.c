@@ -1,10 +1,26 @@
 /* interrupt.c */
 
+#include "interrupt.h"
+
 #define INT_BASE	(0xca000000)
 #define INTMSK		(INT_BASE+0x8)
 #define INTOFFSET	(INT_BASE+0x14)
 #define INTPND		(INT_BASE+0x10)
 #define SRCPND		(INT_BASE+0x0)
+#define SUBSRCPND	(INT_BASE+0x18)
+#define INTSUBMSK	(INT_BASE+0x1c)
+
+// Registered interrupt handlers, indexed by interrupt source
+static irq_handler_t irq_handlers[NR_IRQS];
+
+/* Interrupts that have been acknowledged but not handled yet
+ *
+ * NOTE
+ * __vector_irq runs in "IRQ" mode and only sets the bit of the interrupt
+ * source here; the handlers are run later by common_irq_handler from
+ * __asm_schedule, on the stack of the interrupted process.
+ */
+volatile unsigned int irq_pending;
 
 /* Enable interrupt */
 void enable_irq(void) {
@@ -26,25 +42,111 @@ void disable_irq(void){
 	);
 }
 
+/* Disable interrupt and return the previous CPSR, which is passed to
+ * local_irq_restore() later. Unlike disable_irq()/enable_irq() pairs,
+ * these can be nested.
+ */
+unsigned int local_irq_save(void) {
+	unsigned int flags;
+
+	asm volatile (
+		"mrs %0,cpsr\n\t"
+		"orr r4,%0,#0x80\n\t"
+		"msr cpsr_c,r4\n\t"
+		:"=r"(flags)
+		:
+		:"r4","memory"
+	);
+
+	return flags;
+}
+
+/* Restore the interrupt state saved by local_irq_save() */
+void local_irq_restore(unsigned int flags) {
+	asm volatile (
+		"msr cpsr_c,%0\n\t"
+		:
+		:"r"(flags)
+		:"memory"
+	);
+}
+
 /* Clear the mask bit of the corresponding interrupt */
 void umask_int(unsigned int offset) {
 	*(volatile unsigned int *)INTMSK &= ~(1<<offset);
 }
 
-void common_irq_handler(void) {
-	// Determine the intertupt # 	
-	unsigned int tmp = (1<<(*(volatile unsigned int *)INTOFFSET));
-	
-	printk("%d\t",*(volatile unsigned int *)INTOFFSET);
-	
-	/// Clear the corresponding bit in SRCPND and INTPND
-	*(volatile unsigned int *)SRCPND |= tmp;
-	*(volatile unsigned int *)INTPND |= tmp;
-	
-	enable_irq();
-	printk("timer interrupt occured\n");
-	
-	//disable_irq();
+/* Set the mask bit of the corresponding interrupt */
+void mask_int(unsigned int offset) {
+	*(volatile unsigned int *)INTMSK |= (1<<offset);
+}
+
+/* Clear the mask bit of an interrupt sub-source */
+void umask_subint(unsigned int subirq) {
+	*(volatile unsigned int *)INTSUBMSK &= ~(1<<subirq);
 }
 
+/* Set the mask bit of an interrupt sub-source */
+void mask_subint(unsigned int subirq) {
+	*(volatile unsigned int *)INTSUBMSK |= (1<<subirq);
+}
+
+/* Get and clear the pending sub-sources among "mask" (bits of SUBIRQ_XXX) of
+ * the shared interrupt "irq"
+ *
+ * NOTE
+ * The handler of a shared interrupt calls it, since __vector_irq only clears 
+ * SRCPND and INTPND. A pending sub-source sets the bit of "irq" in SRCPND 
+ * again, so that bit is cleared once more after SUBSRCPND; otherwise the 
+ * interrupt would fire again with nothing to do.
+ */
+unsigned int ack_subint(unsigned int irq, unsigned int mask) {
+	unsigned int pending = *(volatile unsigned int *)SUBSRCPND & mask;
+
+	// Writing 1 clears the bit
+	*(volatile unsigned int *)SUBSRCPND = pending;
+	*(volatile unsigned int *)SRCPND = 1<<irq;
+	if(*(volatile unsigned int *)INTPND & (1<<irq)) {
+		*(volatile unsigned int *)INTPND = 1<<irq;
+	}
+
+	return pending;
+}
+
+/* Register the handler of interrupt "irq" and unmask the interrupt */
+int request_irq(unsigned int irq, irq_handler_t handler) {
+	if(irq >= NR_IRQS || irq_handlers[irq]) { return -1; }
 
+	irq_handlers[irq] = handler;
+	umask_int(irq);
+
+	return 0;
+}
+
+// Context of the process interrupted by the interrupt being handled
+static struct pt_regs *irq_regs;
+
+/* Get the interrupted context from an interrupt handler */
+struct pt_regs *get_irq_regs(void) {
+	return irq_regs;
+}
+
+/* Run the handlers of all pending interrupts
+ *
+ * NOTE
+ * It is called by __asm_schedule with interrupts disabled, so it needs not
+ * worry about "irq_pending" being changed under its feet.
+ */
+void common_irq_handler(struct pt_regs *regs) {
+	unsigned int pending = irq_pending;
+	unsigned int irq;
+
+	irq_pending = 0;
+	irq_regs = regs;
+
+	for(irq=0; pending; irq++, pending>>=1) {
+		if((pending & 1) && irq_handlers[irq]) {
+			irq_handlers[irq](irq);
+		}
+	}
+}
@@ -0,0 +1,47 @@
+/* interrupt.h */
+
+#ifndef INTERRUPT_H
+#define INTERRUPT_H
+
+
+/// Interrupt sources of s3c2410, i.e., the values of register INTOFFSET
+#define IRQ_TIMER0	10
+#define IRQ_TIMER1	11
+#define IRQ_TIMER2	12
+#define IRQ_TIMER3	13
+#define IRQ_TIMER4	14
+#define IRQ_UART0	28
+
+#define NR_IRQS		32
+
+/// Sub-sources of interrupts shared by several sources, i.e., the bits of 
+/// registers SUBSRCPND and INTSUBMSK
+#define SUBIRQ_RXD0	0
+#define SUBIRQ_TXD0	1
+#define SUBIRQ_ERR0	2
+
+// Type of interrupt handlers; "irq" is the interrupt source being handled
+typedef void (*irq_handler_t)(unsigned int irq);
+
+// Context of the interrupted process, saved on its stack by __asm_schedule
+struct pt_regs {
+	unsigned int cpsr;
+	unsigned int r[13];    // R0 ~ R12
+	unsigned int lr;
+	unsigned int pc;       // addr of the interrupted instr
+};
+
+void enable_irq(void);
+void disable_irq(void);
+unsigned int local_irq_save(void);
+void local_irq_restore(unsigned int flags);
+void umask_int(unsigned int offset);
+void mask_int(unsigned int offset);
+void umask_subint(unsigned int subirq);
+void mask_subint(unsigned int subirq);
+unsigned int ack_subint(unsigned int irq, unsigned int mask);
+int request_irq(unsigned int irq, irq_handler_t handler);
+struct pt_regs *get_irq_regs(void);
+
+
+#endif // INTERRUPT_H
@@ -1,17 +1,22 @@
 /* memory.c */
 
 #include "util_list.h"
+#include "memory.h"
+#include "trace.h"
+#include "interrupt.h"
+#include "initcall.h"
+#include "print.h"
 
 /* -------------- buddy algorithm ---------------- */
 
 /// Starting and end addrs of memory for paging
-#define _MEM_START	0x300f0000
+// NOTE  The kernel image ends with its init section, see kernel.lds. Paging
+// memory starts there; the pages of the init section are in use until
+// free_initmem() gives them back.
+extern char __init_start[], __init_end[];
+#define _MEM_START	((unsigned int)__init_start)
 #define _MEM_END	0x30700000
 
-#define PAGE_SHIFT	(12)
-#define PAGE_SIZE	(1<<PAGE_SHIFT)	// Page size is 4KB
-#define PAGE_MASK	(~(PAGE_SIZE-1))
-
 #define KERNEL_MEM_END (_MEM_END)
 
 /// Starting and end addrs of paging-memory that are aligned by page size
@@ -58,7 +63,7 @@ struct page {
 #define MAX_BUDDY_PAGE_NUM	(9)
 
 #define AVERAGE_PAGE_NUM_PER_BUDDY	(KERNEL_PAGE_NUM / MAX_BUDDY_PAGE_NUM)
-#define PAGE_NUM_FOR_MAX_BUDDY	( (1<<MAX_BUDDY_PAGE_NUM) - 1 )
+#define PAGE_NUM_FOR_MAX_BUDDY	( (1<<(MAX_BUDDY_PAGE_NUM-1)) - 1 )
 
 // List heads of different buddy groups
 // NOTE! 
@@ -85,7 +90,7 @@ struct page *virt_to_page(unsigned int addr)
 /*
  * Initialize list heads of each buddy group 
  */
-void init_page_buddy(void)
+void __init init_page_buddy(void)
 {
     int i;
 
@@ -103,13 +108,15 @@ void init_page_buddy(void)
  * buddy. For each buddy, the field "order" in the header "page" struct is 
  * set to the corresponding order, and those in others are set to -1. 
  */
-void init_page_map(void)
+int __init init_page_map(void)
 {
-    int i;
+    int i, j;
     // NOTE!
     // KERNEL_PAGE_START is the starting addr of memory block for storing
     // struct "page"'s
     struct page *pg = (struct page *) KERNEL_PAGE_START;
+    // The pages of the init section come first
+    int nr_init = ((unsigned int) __init_end - KERNEL_PAGING_START) >> PAGE_SHIFT;
 
     init_page_buddy();
 
@@ -120,8 +127,17 @@ void init_page_map(void)
 	pg->counter = 0;
 	INIT_LIST_HEAD(&(pg->list));
 
+	/// Pages of the init section are allocated buddies of 1 page each, 
+	/// which free_initmem() returns
+	if (i < nr_init) {
+	    pg->flags = PAGE_BUDDY_BUSY;
+	    pg->order = 0;
+	    continue;
+	}
+	j = i - nr_init;
+
 	// / Make each buddy as large as possible
-	if (i < (KERNEL_PAGE_NUM & (~PAGE_NUM_FOR_MAX_BUDDY))) {
+	if (j < ((KERNEL_PAGE_NUM - nr_init) & (~PAGE_NUM_FOR_MAX_BUDDY))) {
 	    // / Each buddy consists of one or more pages, and is
 	    // represented by the header "page" struct.
 	    // / The field "order" is used to distinguish the header
@@ -130,7 +146,7 @@ void init_page_map(void)
 	    // the header "page" struct is 
 	    // / set to the corresponding order, and those in others are
 	    // set to -1.
-	    if ((i & PAGE_NUM_FOR_MAX_BUDDY) == 0) {
+	    if ((j & PAGE_NUM_FOR_MAX_BUDDY) == 0) {
 		pg->order = MAX_BUDDY_PAGE_NUM - 1;
 	    } else {
 		pg->order = -1;
@@ -148,7 +164,10 @@ void init_page_map(void)
 	}
 
     }
+
+    return 0;
 }
+core_initcall(init_page_map);
 
 
 // / We can do these all because the page structure that represents one
@@ -156,6 +175,8 @@ void init_page_map(void)
 #define BUDDY_END(x,order)	((x)+(1<<(order))-1)
 #define NEXT_BUDDY_START(x,order)	((x)+(1<<(order)))
 #define PREV_BUDDY_START(x,order)	((x)-(1<<(order)))
+#define PAGE_MAP_START	((struct page *) KERNEL_PAGE_START)
+#define PAGE_MAP_END	(PAGE_MAP_START + KERNEL_PAGE_NUM)
 
 /*
  * Request a buddy of 2^order pages
@@ -227,13 +248,16 @@ void put_pages_to_list(struct page *pg, int order)
     // buddy, the two buddies should
     // / have the same order, in addition to the same flags indicating
     // that they are not in use
-    for (; order < MAX_BUDDY_PAGE_NUM; order++) {
+    for (; order < MAX_BUDDY_PAGE_NUM - 1; order++) {
 	// / The struct "page" addrs of the buddies immediately before and 
 	// after the releasing buddy 
 	tnext = NEXT_BUDDY_START(pg, order);
 	tprev = PREV_BUDDY_START(pg, order);
 
-	if ((!(tnext->flags & PAGE_BUDDY_BUSY)) && (tnext->order == order)) {
+	// / Neither may lie outside the struct "page"'s, e.g., when the
+	// first page, one of the init section, is returned
+	if (BUDDY_END(tnext, order) < PAGE_MAP_END
+	    && (!(tnext->flags & PAGE_BUDDY_BUSY)) && (tnext->order == order)) {
 	    pg->order++;
 	    tnext->order = -1;
 	    list_remove_chain(&(tnext->list),
@@ -242,11 +266,13 @@ void put_pages_to_list(struct page *pg, int order)
 	    tnext->list.prev = &(BUDDY_END(pg, order)->list);
 	    continue;
 
-	} else if ((!(tprev->flags & PAGE_BUDDY_BUSY))
+	} else if (tprev >= PAGE_MAP_START
+		   && (!(tprev->flags & PAGE_BUDDY_BUSY))
 		   && (tprev->order == order)) {
 	    pg->order = -1;
 
-	    list_remove_chain(&(pg->list), &(BUDDY_END(pg, order)->list));
+	    list_remove_chain(&(tprev->list),
+			      &(BUDDY_END(tprev, order)->list));
 	    BUDDY_END(tprev, order)->list.next = &(pg->list);
 	    pg->list.prev = &(BUDDY_END(tprev, order)->list);
 
@@ -259,7 +285,8 @@ void put_pages_to_list(struct page *pg, int order)
 	}
     }
 
-    list_add_chain(&(pg->list), &((tnext - 1)->list), &page_buddy[order]);
+    list_add_chain(&(pg->list), &(BUDDY_END(pg, order)->list),
+		   &page_buddy[order]);
 }
 
 /*
@@ -279,17 +306,23 @@ void *page_address(struct page *pg)
 struct page *alloc_pages(unsigned int flag, int order)
 {
     struct page *pg;
+    unsigned int flags;
     int i;
 
+    // The scheduler frees the pages of dead processes, see release_task()
+    flags = local_irq_save();
     pg = get_pages_from_list(order);
+	trace_printk("alloc_pages: order %d -> %x", order, pg);
 
     if (pg == NULL) {
+		local_irq_restore(flags);
 		return NULL;
 	} 
 
     for (i = 0; i < (1 << order); i++) {
 	(pg + i)->flags |= PAGE_DIRTY;
     }
+    local_irq_restore(flags);
 
     return pg;
 }
@@ -300,13 +333,16 @@ struct page *alloc_pages(unsigned int flag, int order)
  */
 void free_pages(struct page *pg, int order)
 {
+    unsigned int flags;
     int i;
 
+    flags = local_irq_save();
     for (i = 0; i < (1 << order); i++) {
 	(pg + i)->flags &= ~PAGE_DIRTY;
     }
 
     put_pages_to_list(pg, order);
+    local_irq_restore(flags);
 }
 
 /*
@@ -336,19 +372,24 @@ void put_free_pages(void *addr, int order)
     free_pages(virt_to_page((unsigned int) addr), order);
 }
 
+/*
+ * Give the pages of the init section to the buddy allocator, once nothing in 
+ * it will be used again, i.e., after all init functions have run 
+ */
+void free_initmem(void)
+{
+    unsigned int addr;
 
-/* ----------- slab Implementation ------------- */
+    for (addr = KERNEL_PAGING_START; addr < (unsigned int) __init_end; addr += PAGE_SIZE) {
+	put_free_pages((void *) addr, 0);
+    }
+
+    printk("Freeing init memory: %uK\n", 
+	((unsigned int) __init_end - KERNEL_PAGING_START) >> 10);
+}
 
-// NOTE that an slab cache can only contain one or more buddies of the same size
-struct kmem_cache {
-    unsigned int obj_size;	 // size (in bytes) of each memory block 
-    unsigned int obj_num;	 // # of available memory blocks
-    unsigned int page_order; // order of each buddy
-    unsigned int flags;
-    struct page *head_page;	 // pointer to the starting page's struct of the cache 
-    struct page *end_page;	 // pointer to the end page's struct of the cache 
-    void *nf_block;		     // pointer to the available memory block in the cache 
-};
+
+/* ----------- slab Implementation ------------- */
 
 // Default memory block size of an slab cache is 2^0=1 page
 #define KMEM_CACHE_DEFAULT_ORDER	(0)
@@ -477,6 +518,7 @@ void *kmem_cache_alloc(struct kmem_cache *cache, unsigned int flag)
 {
     void *p;
     struct page *pg;
+    unsigned int flags;
     
 	if(cache == NULL) return NULL;
     
@@ -484,8 +526,11 @@ void *kmem_cache_alloc(struct kmem_cache *cache, unsigned int flag)
     unsigned int *num = &(cache->obj_num);
     int order = cache->page_order;
 
+    // Processes and interrupt handlers share the caches, see alloc_pages()
+    flags = local_irq_save();
     if(!*num) {
 		if((pg = alloc_pages(0, order)) == NULL) { 
+			local_irq_restore(flags);
 			return NULL; 
 		}	
 		
@@ -502,6 +547,8 @@ void *kmem_cache_alloc(struct kmem_cache *cache, unsigned int flag)
     *nf_block = *(void **) p;
     pg = virt_to_page((unsigned int) p);
     pg->cachep = cache;		
+	trace_printk("kmem_cache_alloc: cache %x size %u -> %x", cache, cache->obj_size, p);
+    local_irq_restore(flags);
     
 	return p;
 }
@@ -514,15 +561,18 @@ void *kmem_cache_alloc(struct kmem_cache *cache, unsigned int flag)
 */
 void kmem_cache_free(struct kmem_cache *cache, void *objp)
 {
+    unsigned int flags;
+
+    flags = local_irq_save();
     *(void **) objp = cache->nf_block;
     cache->nf_block = objp;
     cache->obj_num++;
+    local_irq_restore(flags);
 }
 
 /* ----------------- kmalloc Implementation ------------------------ */
 
 #define KMALLOC_BIAS_SHIFT			(5)		// 32 byte minimal
-#define KMALLOC_MAX_SIZE			(4096)
 #define KMALLOC_MINIMAL_SIZE_BIAS	(1<<(KMALLOC_BIAS_SHIFT))
 #define KMALLOC_CACHE_SIZE			(KMALLOC_MAX_SIZE/KMALLOC_MINIMAL_SIZE_BIAS)
 
@@ -531,7 +581,7 @@ struct kmem_cache kmalloc_cache[KMALLOC_CACHE_SIZE] = { {0, 0, 0, 0, NULL, NULL,
 #define kmalloc_cache_size_to_index(size)	((((size))>>(KMALLOC_BIAS_SHIFT)))
 
 /* Initialize kmalloc_cache[] */
-int kmalloc_init(void)
+int __init kmalloc_init(void)
 {
     int i = 0;
 
@@ -543,6 +593,8 @@ int kmalloc_init(void)
     
 	return 0;
 }
+// After init_page_map(), which is in this file as well, see initcall.h
+subsys_initcall(kmalloc_init);
 
 /* Allocate a "size"-byte memory */
 void *kmalloc(unsigned int size)
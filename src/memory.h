@@ -0,0 +1,41 @@
+/* memory.h */
+
+#ifndef MEMORY_H
+#define MEMORY_H
+
+
+#define PAGE_SHIFT	(12)
+#define PAGE_SIZE	(1<<PAGE_SHIFT)	// Page size is 4KB
+#define PAGE_MASK	(~(PAGE_SIZE-1))
+
+/// Buddy allocator
+void *get_free_pages(unsigned int flag, int order);
+void put_free_pages(void *addr, int order);
+void free_initmem(void);
+
+/// Slab allocator
+// NOTE that an slab cache can only contain one or more buddies of the same size
+struct page;
+struct kmem_cache {
+    unsigned int obj_size;	 // size (in bytes) of each memory block 
+    unsigned int obj_num;	 // # of available memory blocks
+    unsigned int page_order; // order of each buddy
+    unsigned int flags;
+    struct page *head_page;	 // pointer to the starting page's struct of the cache 
+    struct page *end_page;	 // pointer to the end page's struct of the cache 
+    void *nf_block;		     // pointer to the available memory block in the cache 
+};
+
+struct kmem_cache *kmem_cache_create(struct kmem_cache *cache, 
+					unsigned int size, unsigned int flags);
+void kmem_cache_destroy(struct kmem_cache *cache);
+void *kmem_cache_alloc(struct kmem_cache *cache, unsigned int flag);
+void kmem_cache_free(struct kmem_cache *cache, void *objp);
+
+/// kmalloc; at most KMALLOC_MAX_SIZE-1 bytes can be allocated at a time
+#define KMALLOC_MAX_SIZE	(4096)
+void *kmalloc(unsigned int size);
+void kfree(void *addr);
+
+
+#endif // MEMORY_H
@@ -1,5 +1,8 @@
 /* mmu.c */
 
+#include "mmu.h"
+#include "initcall.h"
+
 // Mask for page table base addr
 #define PAGE_TABLE_L1_BASE_ADDR_MASK	(0xffffc000)
 
@@ -12,6 +15,20 @@
 #define PTE_L1_SECTION_PADDR_BASE_MASK	(0xfff00000)
 #define PTE_BITS_L1_SECTION				(0x2)
 
+/// L1 entries pointing to a coarse L2 table, and L2 entries of 4KB pages
+#define PTE_L1_COARSE_BASE_MASK		(0xfffffc00)
+#define PTE_BITS_L1_COARSE			(0x11)	// bit 4 must be 1 on ARM920T
+#define PTE_BITS_L1_MASK			(0x3)
+#define PTE_L2_SMALL_PADDR_BASE_MASK	(0xfffff000)
+#define PTE_BITS_L2_SMALL			(0x2)
+#define PTE_L2_AP_SHIFT				4		// AP0~AP3 for the four 1KB subpages
+
+#define VIRT_TO_PTE_L2_INDEX(addr)	(((addr)&0x000ff000)>>12)
+
+// # of coarse L2 tables, each of which maps 1MB with 4KB pages
+#define L2_COARSE_TABLE_NR			8
+#define L2_COARSE_TABLE_ENTRIES		256
+
 // NOTE that this is a physical addr
 #define L1_PTR_BASE_ADDR			0x30700000
 
@@ -28,7 +45,7 @@
 #define PHYSICAL_VECTOR_ADDR		0x30000000
 
 
-void start_mmu(void) {
+void __init start_mmu(void) {
 	unsigned int ttb=L1_PTR_BASE_ADDR;
 	
 	asm(
@@ -81,7 +98,7 @@ unsigned int gen_l1_pte_addr(unsigned int baddr, unsigned int vaddr) {
 /* Initialize page table, mapping the 8MB physical memory 0x30000000~0x30800000 to 
 virtual memory 0x30000000~0x30800000
 */
-void init_sys_mmu(void) {
+void __init init_sys_mmu(void) {
 	unsigned int pte;
 	unsigned int pte_addr;
 	int j;
@@ -125,11 +142,108 @@ void remap_l1(unsigned int paddr, unsigned int vaddr, int size)
 	unsigned int pte;
 	unsigned int pte_addr;
 	
-	for(; size>0; size-=1<<20) {
+	for(; size>0; size-=1<<20, paddr+=1<<20, vaddr+=1<<20) {
 		pte=gen_l1_pte(paddr);
 		pte_addr=gen_l1_pte_addr(L1_PTR_BASE_ADDR,vaddr);
 		*(volatile unsigned int *)pte_addr=pte;
 	}
 
+	flush_tlb_all();
+
+}
+
+
+/* Coarse L2 tables; each must be aligned by 1KB */
+static unsigned int l2_coarse_tables[L2_COARSE_TABLE_NR][L2_COARSE_TABLE_ENTRIES]
+	__attribute__((aligned(1024)));
+static int l2_coarse_tables_used;
+
+/* Invalidate the whole TLB after changing the page table */
+void flush_tlb_all(void)
+{
+	asm volatile (
+		"mov r0,#0\n\t"
+		"mcr p15,0,r0,c8,c7,0\n\t"
+		:::"r0","memory"
+	);
+}
+
+/* Check whether virtual addr "vaddr" is mapped by a 1MB section, e.g., the
+ * kernel memory
+ */
+int section_mapped(unsigned int vaddr)
+{
+	unsigned int pte = *(volatile unsigned int *)gen_l1_pte_addr(L1_PTR_BASE_ADDR, vaddr);
+
+	return (pte & PTE_BITS_L1_MASK) == PTE_BITS_L1_SECTION;
+}
+
+/* Map the 4KB page at virtual addr "vaddr" to physical addr "paddr", with
+ * access permission "ap" (one of PTE_AP_XXX)
+ *
+ * NOTE
+ * 1. The 1MB section of "vaddr" must either be unmapped or already be mapped
+ *    with a coarse L2 table; a section mapping is never split.
+ * 2. Kernel memory is mapped 1:1, so the addr of a coarse L2 table is both
+ *    its virtual and physical addr.
+ *
+ * Return value: 0 on success, -1 if no coarse L2 table is left or the section
+ *  is mapped as a whole
+ */
+int map_page(unsigned int vaddr, unsigned int paddr, unsigned int ap)
+{
+	volatile unsigned int *l1_pte;
+	unsigned int *l2;
+
+	l1_pte = (volatile unsigned int *)gen_l1_pte_addr(L1_PTR_BASE_ADDR, vaddr);
+
+	if((*l1_pte & PTE_BITS_L1_MASK) == 0) {
+		if(l2_coarse_tables_used == L2_COARSE_TABLE_NR) {
+			return -1;
+		}
+		l2 = l2_coarse_tables[l2_coarse_tables_used++];
+		*l1_pte = ((unsigned int)l2 & PTE_L1_COARSE_BASE_MASK) |
+			PTE_L1_SECTION_DOMAIN_DEFAULT | PTE_BITS_L1_COARSE;
+	} else if((*l1_pte & PTE_BITS_L1_MASK) == (PTE_BITS_L1_COARSE & PTE_BITS_L1_MASK)) {
+		l2 = (unsigned int *)(*l1_pte & PTE_L1_COARSE_BASE_MASK);
+	} else {
+		return -1;
+	}
+
+	// The same permission for all four subpages
+	ap &= 0x3;
+	ap = ap | (ap<<2) | (ap<<4) | (ap<<6);
+	l2[VIRT_TO_PTE_L2_INDEX(vaddr)] = (paddr & PTE_L2_SMALL_PADDR_BASE_MASK) |
+		(ap<<PTE_L2_AP_SHIFT) | PTE_BITS_L2_SMALL;
+
+	flush_tlb_all();
+
+	return 0;
 }
 
+/* Unmap the 4KB page at virtual addr "vaddr"
+ *
+ * Return value: the L2 entry the page was mapped with, or 0 if it was not 
+ *  mapped by a page
+ */
+unsigned int unmap_page(unsigned int vaddr)
+{
+	volatile unsigned int *l1_pte;
+	unsigned int *l2, pte;
+
+	l1_pte = (volatile unsigned int *)gen_l1_pte_addr(L1_PTR_BASE_ADDR, vaddr);
+	if((*l1_pte & PTE_BITS_L1_MASK) != (PTE_BITS_L1_COARSE & PTE_BITS_L1_MASK)) {
+		return 0;
+	}
+
+	l2 = (unsigned int *)(*l1_pte & PTE_L1_COARSE_BASE_MASK);
+	pte = l2[VIRT_TO_PTE_L2_INDEX(vaddr)];
+	if((pte & PTE_BITS_L1_MASK) != PTE_BITS_L2_SMALL) {
+		return 0;
+	}
+	l2[VIRT_TO_PTE_L2_INDEX(vaddr)] = 0;
+
+	flush_tlb_all();
+
+	return pte;
+}
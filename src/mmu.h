@@ -0,0 +1,26 @@
+/* mmu.h */
+
+#ifndef MMU_H
+#define MMU_H
+
+
+/// Access permission of page table entries
+/// NOTE  They are only checked for domains in "client" mode
+#define PTE_AP_KERNEL_RW	0x1		// kernel: read/write; user: no access
+#define PTE_AP_USER_RO		0x2		// kernel: read/write; user: read only
+#define PTE_AP_USER_RW		0x3		// kernel: read/write; user: read/write
+
+/// Fields of an L2 entry returned by unmap_page()
+#define PTE_L2_PADDR(pte)	((pte) & 0xfffff000)
+#define PTE_L2_AP(pte)		(((pte) >> 4) & 0x3)
+
+void init_sys_mmu(void);
+void start_mmu(void);
+void remap_l1(unsigned int paddr, unsigned int vaddr, int size);
+void flush_tlb_all(void);
+int section_mapped(unsigned int vaddr);
+int map_page(unsigned int vaddr, unsigned int paddr, unsigned int ap);
+unsigned int unmap_page(unsigned int vaddr);
+
+
+#endif // MMU_H
@@ -1,19 +1,46 @@
-/* print.c */
+/* print.c
+ * Kernel formatted output: vsnprintf(), snprintf() and printk()
+ *
+ * NOTE
+ * 1. Conversions are "%[flags][width][.precision][length]type", where flags
+ *    are any of "-+ 0#", width and precision are digits or "*", length is
+ *    "hh", "h", "l" or "z" and type one of "diuxXocsp%". All ints are 32
+ *    bits; "ll" is not supported.
+ * 2. The CPU has no divider, so decimal digits are got by multiplying by
+ *    the reciprocal of 10 instead of dividing, and the other bases by shifts.
+ * 3. Nothing is formatted in global buffers, so all of these can be called
+ *    from interrupt handlers while a process is in the middle of a printk().
+ *    printk() formats on the stack, in at most PRINTK_BUF_SIZE-1 chars.
+*/
 
-typedef char * va_list;
+#include "string.h"
+#include "uart.h"
+#include "print.h"
+#include "initcall.h"
+
+#ifdef CONFIG_HOST
+#define va_start(ap,v)	__builtin_va_start(ap,v)
+#define va_arg(ap,t)	__builtin_va_arg(ap,t)
+#define va_copy(d,s)	__builtin_va_copy(d,s)
+#define va_end(ap)		__builtin_va_end(ap)
+#else
 // Calculate the size of a type that is upsized in unit of 4 
 #define _INTSIZEOF(n)   ((sizeof(n)+sizeof(int)-1)&~(sizeof(int) - 1) )
 #define va_start(ap,v) ( ap = (va_list)&v + _INTSIZEOF(v) )
 #define va_arg(ap,t) ( *(t *)((ap += _INTSIZEOF(t)) - _INTSIZEOF(t)) )
+#define va_copy(d,s)  ( (d) = (s) )
 #define va_end(ap)    ( ap = (va_list)0 )
+#endif
+
+#define NULL ((void *)0)
 
-void test_num(int num) {
+void __init test_num(int num) {
 	/// Physical addr 0x50000020 is the register addr of s3c2410's serial FIFO
 	/// virtual addr 0xd0000020 is mapped to physical addr 0x50000020
 	*(char *)0xd0000020 = num + '0';
 }
 
-void test_vparameter(int i, ...) {
+void __init test_vparameter(int i, ...) {
 	int mm;
 	
 	va_list argv;
@@ -31,266 +58,447 @@ void test_vparameter(int i, ...) {
 }
 
 
-const char *digits="0123456789abcdef";
-char numbers[68];
-static char print_buf[1024];
-
-#define FORMAT_TYPE_MASK	0xff00
-#define FORMAT_TYPE_SIGN_BIT	0x0100
-#define FORMAT_TYPE_NONE	0x000
-#define FORMAT_TYPE_CHAR	0x100
-#define FORMAT_TYPE_UCHAR	0x200
-#define FORMAT_TYPE_SHORT	0x300
-#define FORMAT_TYPE_USHORT	0x400
-#define FORMAT_TYPE_INT		0x500
-#define FORMAT_TYPE_UINT	0x600
-#define FORMAT_TYPE_LONG	0x700
-#define FORMAT_TYPE_ULONG	0x800
-#define FORMAT_TYPE_STR		0xd00
-#define FORMAT_TYPE_PTR		0x900
-#define FORMAT_TYPE_SIZE_T	0xb00
-
-#define FORMAT_TYPE(x)	((x)&FORMAT_TYPE_MASK)
-#define SET_FORMAT_TYPE(x,t)	do{ (x)&=~FORMAT_TYPE_MASK; (x)|=(t);}while(0)
-#define FORMAT_SIGNED(x)	((x)&FORMAT_TYPE_SIGN_BIT)
-
-#define FORMAT_FLAG_MASK	0xffff0000
-#define FORMAT_FLAG_SPACE	0x10000
-#define FORMAT_FLAG_ZEROPAD	0x20000
-#define FORMAT_FLAG_LEFT	0x40000
-#define	FORMAT_FLAG_WIDTH	0x100000
-
-#define FORMAT_FLAG(x)	((x)&FORMAT_FLAG_MASK)
-#define SET_FORMAT_FLAG(x,f)	((x)|=(f))
-
-#define FORMAT_BASE_MASK	0xff
-#define FORMAT_BASE_O		0x08
-#define FORMAT_BASE_X		0x10
-#define FORMAT_BASE_D		0x0a
-#define FORMAT_BASE_B		0x02
-
-#define FORMAT_BASE(x)	(FORMAT_BASE_MASK&(x))
-#define SET_FORMAT_BASE(x,t) do{(x)&=~FORMAT_BASE_MASK;(x)|=(t);}while(0)
-
-#define do_div(n,base) ({ \
-	int __res; \
-	__res = ((unsigned int) n) % (unsigned int) base; \
-	n = ((unsigned int) n) / (unsigned int) base; \
-	__res; }) 
-
+#define PRINTK_BUF_SIZE		256
+
+/// Conversion types
+#define FORMAT_TYPE_NONE	0	// a run of literal chars
+#define FORMAT_TYPE_CHAR	1
+#define FORMAT_TYPE_STR		2
+#define FORMAT_TYPE_PTR		3
+#define FORMAT_TYPE_PERCENT	4
+#define FORMAT_TYPE_INVALID	5	// printed as it is
+#define FORMAT_TYPE_INT		6	// all types from here on are numbers
+#define FORMAT_TYPE_UINT	7
+#define FORMAT_TYPE_SHORT	8
+#define FORMAT_TYPE_USHORT	9
+#define FORMAT_TYPE_BYTE	10
+#define FORMAT_TYPE_UBYTE	11
+
+/// Flags
+#define FORMAT_FLAG_LEFT	0x01	// '-'
+#define FORMAT_FLAG_PLUS	0x02	// '+'
+#define FORMAT_FLAG_SPACE	0x04	// ' '
+#define FORMAT_FLAG_ZEROPAD	0x08	// '0'
+#define FORMAT_FLAG_SPECIAL	0x10	// '#': 0x for hex, 0 for octal
+#define FORMAT_FLAG_SMALL	0x20	// lowercase hex digits
+
+// A decoded conversion
+struct printf_spec {
+	unsigned char type;     // FORMAT_TYPE_*
+	unsigned char flags;    // FORMAT_FLAG_*
+	unsigned char base;     // 8, 10 or 16
+	short field_width;      // -1 if not given
+	short precision;        // -1 if not given
+};
+
+/// Write "c" to "buf" if it is before "end"; "buf" always moves on, so the
+/// length of the whole output is known in the end
+#define PUT_CHAR(buf, end, c)	do { if((buf) < (end)) { *(buf) = (c); } (buf)++; } while(0)
+
+/* Divide by 10 by multiplying by 2^35/10 rounded up, which is exact for all 
+ * 32-bit ints; it is a UMULL and a shift
+ */
+static inline unsigned int div10(unsigned int n)
+{
+	return (unsigned int)(((unsigned long long)n * 0xcccccccdULL) >> 35);
+}
 
+/* Output at most "num" chars of string "p" through the UART driver, which 
+ * queues them without waiting for the transmission
+ */
 void __put_char(char *p, int num)
 {
-	while(*p && num--){
-		*(volatile unsigned int *)0xd0000020 = *p++;
-	};
+	int n;
+
+	for(n=0; n<num && p[n]; n++);
+	uart_write(p, n);
 }
 
-void * memcpy(void * dest, const void *src, unsigned int count)
+/* Skip the decimal digits at "*s" and return their value */
+static int skip_atoi(const char **s)
 {
-	char *tmp = (char *) dest, *s = (char *) src;
-	
-	while(count--) { *tmp++ = *s++; }
-	
-	return dest;
+	int i = 0;
+
+	while(**s >= '0' && **s <= '9') {
+		i = i*10 + *((*s)++) - '0';
+	}
+
+	return i;
 }
 
-/* Convert an number into a string 
- 
- NOTE!
- Base and sign are required 
-*/
-char * number(char *str, int num, int base, unsigned int flags)
+/* Convert number "num" as "spec" says, writing to "buf" but not past "end"
+ *
+ * Return value: where the next char goes
+ */
+static char *number(char *buf, char *end, unsigned int num, struct printf_spec spec)
 {
-	int i = 0;
-	int sign = 0;
+	const char *digits = (spec.flags & FORMAT_FLAG_SMALL) ? "0123456789abcdef" :
+		"0123456789ABCDEF";
+	char tmp[12];           // 11 octal digits are the most an int takes
+	char sign = 0;
+	int i = 0, prefix = 0, width, q;
+
+	if(spec.type == FORMAT_TYPE_INT || spec.type == FORMAT_TYPE_SHORT ||
+		spec.type == FORMAT_TYPE_BYTE) {
+		if((int)num < 0) {
+			sign = '-';
+			num = -num;
+		} else if(spec.flags & FORMAT_FLAG_PLUS) {
+			sign = '+';
+		} else if(spec.flags & FORMAT_FLAG_SPACE) {
+			sign = ' ';
+		}
+	}
+	if((spec.flags & FORMAT_FLAG_SPECIAL) && spec.base == 16 && num != 0) {
+		prefix = 2;
+	}
 
-	if(FORMAT_SIGNED(flags) && (signed int)num<0) {
-		sign = 1;
-		num = ~num + 1;
+	/// Digits, the least significant first; precision 0 prints no 0
+	if(num != 0 || spec.precision != 0) {
+		if(spec.base == 10) {
+			do {
+				q = div10(num);
+				tmp[i++] = '0' + (num - q*10);
+				num = q;
+			} while(num != 0);
+		} else {
+			unsigned int shift = spec.base == 16 ? 4 : 3;
+			do {
+				tmp[i++] = digits[num & (spec.base - 1)];
+				num >>= shift;
+			} while(num != 0);
+		}
 	}
 
-	do {
-		numbers[i++]=digits[do_div(num,base)];
-	} while(num!=0);
-	
+	// A precision turns the '0' flag off
+	if(spec.precision >= 0) {
+		spec.flags &= ~FORMAT_FLAG_ZEROPAD;
+	}
+	if(spec.precision < i) {
+		spec.precision = i;
+	}
+	// '#' makes octal digits start with a 0, unless they already do
+	if((spec.flags & FORMAT_FLAG_SPECIAL) && spec.base == 8 &&
+		spec.precision == i && (i == 0 || tmp[i-1] != '0')) {
+		prefix = 1;
+	}
+	width = spec.field_width - spec.precision - prefix - (sign != 0);
 
-	if(FORMAT_BASE(flags)==FORMAT_BASE_O) {
-		numbers[i++]='0';
-	} else if(FORMAT_BASE(flags)==FORMAT_BASE_X) {
-		numbers[i++]='x';
-		numbers[i++]='0';
-	} else if(FORMAT_BASE(flags)==FORMAT_BASE_B) {
-		numbers[i++]='b';
-		numbers[i++]='0';
+	if(!(spec.flags & (FORMAT_FLAG_LEFT | FORMAT_FLAG_ZEROPAD))) {
+		for(; width > 0; width--) {
+			PUT_CHAR(buf, end, ' ');
+		}
+	}
+	if(sign) {
+		PUT_CHAR(buf, end, sign);
+	}
+	if(prefix) {
+		PUT_CHAR(buf, end, '0');
+		if(prefix == 2) {
+			PUT_CHAR(buf, end, (spec.flags & FORMAT_FLAG_SMALL) ? 'x' : 'X');
+		}
+	}
+	if(!(spec.flags & FORMAT_FLAG_LEFT)) {
+		for(; width > 0; width--) {
+			PUT_CHAR(buf, end, '0');
+		}
+	}
+	for(; spec.precision > i; spec.precision--) {
+		PUT_CHAR(buf, end, '0');
+	}
+	while(i-- > 0) {
+		PUT_CHAR(buf, end, tmp[i]);
+	}
+	for(; width > 0; width--) {
+		PUT_CHAR(buf, end, ' ');
 	}
-	
-	if(sign) 
-		{ numbers[i++]='-'; }
 
-	while(i-- > 0) 
-		{ *str++ = numbers[i]; }
-	
-	return str;
+	return buf;
 }
 
-int format_decode(const char *fmt, unsigned int *flags) {
-	const char *start = fmt;
+/* Copy string "s", at most "precision" chars of it, padded to the width */
+static char *string(char *buf, char *end, const char *s, struct printf_spec spec)
+{
+	int len, i;
 
-	*flags &= ~FORMAT_TYPE_MASK;
-	*flags |= FORMAT_TYPE_NONE;
-	
-	for(; *fmt ; ++fmt) {
-		if (*fmt == '%') break;
+	if(s == NULL) {
+		s = "(null)";
+	}
+	for(len=0; (spec.precision < 0 || len < spec.precision) && s[len]; len++);
+
+	if(!(spec.flags & FORMAT_FLAG_LEFT)) {
+		for(i=len; i<spec.field_width; i++) {
+			PUT_CHAR(buf, end, ' ');
+		}
 	}
+	for(i=0; i<len; i++) {
+		PUT_CHAR(buf, end, s[i]);
+	}
+	if(spec.flags & FORMAT_FLAG_LEFT) {
+		for(i=len; i<spec.field_width; i++) {
+			PUT_CHAR(buf, end, ' ');
+		}
+	}
+
+	return buf;
+}
+
+/* Decode the literal chars or the conversion at "fmt" into "spec"; a "*" 
+ * width or precision is taken from "*args"
+ *
+ * Return value: # of chars of "fmt" decoded
+ */
+static int format_decode(const char *fmt, struct printf_spec *spec, va_list *args)
+{
+	const char *start = fmt;
 
-	if (fmt != start || !*fmt) 
+	spec->type = FORMAT_TYPE_NONE;
+	spec->flags = 0;
+	spec->base = 10;
+	spec->field_width = -1;
+	spec->precision = -1;
+
+	for(; *fmt && *fmt != '%'; fmt++);
+	if(fmt != start || !*fmt) {
 		return fmt - start;
+	}
+	fmt++;
+
+	/// Flags
+	for(;; fmt++) {
+		if(*fmt == '-') { spec->flags |= FORMAT_FLAG_LEFT; }
+		else if(*fmt == '+') { spec->flags |= FORMAT_FLAG_PLUS; }
+		else if(*fmt == ' ') { spec->flags |= FORMAT_FLAG_SPACE; }
+		else if(*fmt == '0') { spec->flags |= FORMAT_FLAG_ZEROPAD; }
+		else if(*fmt == '#') { spec->flags |= FORMAT_FLAG_SPECIAL; }
+		else { break; }
+	}
 
-	do {
+	/// Width; a negative one from "*" means '-'
+	if(*fmt >= '0' && *fmt <= '9') {
+		spec->field_width = skip_atoi(&fmt);
+	} else if(*fmt == '*') {
 		fmt++;
-		
-		switch(*fmt) {
-			case 'l':
-				SET_FORMAT_FLAG(*flags,FORMAT_FLAG_WIDTH);
-				break;
-			default:
-				break;
+		spec->field_width = va_arg(*args, int);
+		if(spec->field_width < 0) {
+			spec->field_width = -spec->field_width;
+			spec->flags |= FORMAT_FLAG_LEFT;
 		}
+	}
 
-	} while(0);
-	
-	SET_FORMAT_BASE(*flags,FORMAT_BASE_D);
-	
-	switch(*fmt) {
-		case 'c':
-			SET_FORMAT_TYPE(*flags,FORMAT_TYPE_CHAR);
-			break;
+	/// Precision; a negative one from "*" means none
+	if(*fmt == '.') {
+		fmt++;
+		if(*fmt == '*') {
+			fmt++;
+			spec->precision = va_arg(*args, int);
+		} else {
+			spec->precision = skip_atoi(&fmt);
+		}
+		if(spec->precision < 0) {
+			spec->precision = -1;
+		}
+	}
 
-		case 's':
-			SET_FORMAT_TYPE(*flags,FORMAT_TYPE_STR);
-			break;
+	/// Length; "l" and "z" are ints
+	spec->type = FORMAT_TYPE_INT;
+	if(*fmt == 'h') {
+		fmt++;
+		spec->type = FORMAT_TYPE_SHORT;
+		if(*fmt == 'h') {
+			fmt++;
+			spec->type = FORMAT_TYPE_BYTE;
+		}
+	} else if(*fmt == 'l' || *fmt == 'z') {
+		fmt++;
+	}
 
-		case 'o':
-			SET_FORMAT_BASE(*flags,FORMAT_BASE_O);
-			SET_FORMAT_TYPE(*flags,FORMAT_TYPE_UINT);
+	switch(*fmt) {
+		case 'd':
+		case 'i':
+			break;
+		case 'u':
+			spec->type++;   // the unsigned one of the type
 			break;
-
 		case 'x':
+			spec->flags |= FORMAT_FLAG_SMALL;
+			// fall through
 		case 'X':
-			SET_FORMAT_BASE(*flags,FORMAT_BASE_X);
-			SET_FORMAT_TYPE(*flags,FORMAT_TYPE_UINT);
+			spec->base = 16;
+			spec->type++;
 			break;
-
-		case 'd':
-		case 'i':
-			SET_FORMAT_TYPE(*flags,FORMAT_TYPE_INT);
-			SET_FORMAT_BASE(*flags,FORMAT_BASE_D);
+		case 'o':
+			spec->base = 8;
+			spec->type++;
 			break;
-		
-		case 'u':
-			SET_FORMAT_TYPE(*flags,FORMAT_TYPE_UINT);
-			SET_FORMAT_BASE(*flags,FORMAT_BASE_D);
+		case 'c':
+			spec->type = FORMAT_TYPE_CHAR;
 			break;
-
-		default:
+		case 's':
+			spec->type = FORMAT_TYPE_STR;
+			break;
+		case 'p':
+			spec->type = FORMAT_TYPE_PTR;
 			break;
+		case '%':
+			spec->type = FORMAT_TYPE_PERCENT;
+			break;
+		default:
+			// Printed as it is, from the '%'
+			spec->type = FORMAT_TYPE_INVALID;
+			return *fmt ? fmt + 1 - start : fmt - start;
 	}
-	
-	return ++fmt-start;
+
+	return ++fmt - start;
 }
 
-int vsnprintf(char *buf, int size, const char *fmt, va_list args){
-	int num;
-	char *str, *end, c,*s;
-	int read;
-	unsigned int spec=0;
+/* Format a string into "buf" of "size" bytes
+ *
+ * NOTE
+ * Nothing is written beyond "size" bytes, and "buf" is always terminated if 
+ * "size" is not 0.
+ *
+ * Return value: # of chars the whole output takes, without the trailing 
+ *  '\0', even if it has been truncated
+ */
+int vsnprintf(char *buf, int size, const char *fmt, va_list ap)
+{
+	struct printf_spec spec;
+	char *str = buf, *end = buf + (size > 0 ? size : 0);
+	unsigned int num;
+	int read, i;
+	// format_decode() takes the addr of a local copy, which works whatever
+	// type va_list is
+	va_list args;
 
-	str = buf;
-	end = buf + size;
+	va_copy(args, ap);
 
-	if (end < buf) {
-		end = ((void *)-1);
-		size = end - buf;
-	}
-
-	while (*fmt) {
+	while(*fmt) {
 		const char *old_fmt = fmt;
 
-		read = format_decode(fmt, &spec);
+		read = format_decode(fmt, &spec, &args);
 		fmt += read;
 
-		if((FORMAT_TYPE(spec))==FORMAT_TYPE_NONE){
-			int copy = read;
-			if (str < end) {
-				if (copy > end - str)
-					copy = end - str;
-					memcpy(str, old_fmt, copy);
-			}
-			str += read;
-
-		} else if(spec&FORMAT_FLAG_WIDTH){
-			//do nothing
-		} else if(FORMAT_TYPE(spec)==FORMAT_TYPE_CHAR){
-			c = (unsigned char) va_arg(args, int);
-			if (str < end)
-				*str = c;
-			++str;
-		} else if(FORMAT_TYPE(spec)==FORMAT_TYPE_STR){
-			s = (char *) va_arg(args, char *);
-			while(str<end&&*s!='\0'){
-				*str++=*s++;
-			}
-		} else{
-			if(FORMAT_TYPE(spec)==FORMAT_TYPE_INT){
-				num = va_arg(args, int);
-			}else if(FORMAT_TYPE(spec)==FORMAT_TYPE_ULONG){
-				num = va_arg(args, unsigned long);
-			}else if(FORMAT_TYPE(spec)==FORMAT_TYPE_LONG){
-				num = va_arg(args, long);
-			}else if(FORMAT_TYPE(spec)==FORMAT_TYPE_SIZE_T){
-				num = va_arg(args, int);
-			}else if(FORMAT_TYPE(spec)==FORMAT_TYPE_USHORT){
-				num = (unsigned short) va_arg(args, int);
-			}else if(FORMAT_TYPE(spec)==FORMAT_TYPE_SHORT){
-				num = (short) va_arg(args, int);
-			}else{
+		switch(spec.type) {
+			case FORMAT_TYPE_NONE:
+			case FORMAT_TYPE_INVALID:
+				for(i=0; i<read; i++) {
+					PUT_CHAR(str, end, old_fmt[i]);
+				}
+				break;
+
+			case FORMAT_TYPE_PERCENT:
+				PUT_CHAR(str, end, '%');
+				break;
+
+			case FORMAT_TYPE_CHAR:
+				if(!(spec.flags & FORMAT_FLAG_LEFT)) {
+					for(i=1; i<spec.field_width; i++) {
+						PUT_CHAR(str, end, ' ');
+					}
+				}
+				PUT_CHAR(str, end, (char)va_arg(args, int));
+				if(spec.flags & FORMAT_FLAG_LEFT) {
+					for(i=1; i<spec.field_width; i++) {
+						PUT_CHAR(str, end, ' ');
+					}
+				}
+				break;
+
+			case FORMAT_TYPE_STR:
+				str = string(str, end, va_arg(args, char *), spec);
+				break;
+
+			case FORMAT_TYPE_PTR:
+				// As 0x%08x, unless a width is given
+				spec.type = FORMAT_TYPE_UINT;
+				spec.base = 16;
+				spec.flags |= FORMAT_FLAG_SMALL;
+				if(spec.field_width < 0) {
+					PUT_CHAR(str, end, '0');
+					PUT_CHAR(str, end, 'x');
+					spec.precision = 8;
+				} else {
+					spec.flags |= FORMAT_FLAG_SPECIAL;
+				}
+				str = number(str, end, (unsigned int)(unsigned long)va_arg(args, void *), spec);
+				break;
+
+			default:
 				num = va_arg(args, unsigned int);
-			}
-				str=number(str,num,spec&FORMAT_BASE_MASK,spec);
+				if(spec.type == FORMAT_TYPE_SHORT) {
+					num = (short)num;
+				} else if(spec.type == FORMAT_TYPE_USHORT) {
+					num = (unsigned short)num;
+				} else if(spec.type == FORMAT_TYPE_BYTE) {
+					num = (signed char)num;
+				} else if(spec.type == FORMAT_TYPE_UBYTE) {
+					num = (unsigned char)num;
+				}
+				str = number(str, end, num, spec);
+				break;
 		}
 	}
-	
+
+	va_end(args);
+
 	if(size > 0) {
-		if (str < end)
+		if(str < end) {
 			*str = '\0';
-		else
+		} else {
 			end[-1] = '\0';
+		}
 	}
-	
-	return str-buf;
+
+	return str - buf;
 }
 
+/* Format a string into "buf" of "size" bytes; see vsnprintf() */
+int snprintf(char *buf, int size, const char *fmt, ...)
+{
+	va_list args;
+	int i;
+
+	va_start(args, fmt);
+	i = vsnprintf(buf, size, fmt, args);
+	va_end(args);
+
+	return i;
+}
+
+/* Format a string on the stack and queue it to the UART; longer output than
+ * PRINTK_BUF_SIZE-1 chars is truncated
+ */
 void printk(const char *fmt, ...)
 {
+	char buf[PRINTK_BUF_SIZE];
 	va_list args;
-	unsigned int i;
+	int i;
 
 	va_start(args, fmt);
-	i = vsnprintf(print_buf, sizeof(print_buf),fmt, args);
+	i = vsnprintf(buf, sizeof(buf), fmt, args);
 	va_end(args);
 
-	__put_char(print_buf,i);
+	if(i > (int)sizeof(buf) - 1) {
+		i = sizeof(buf) - 1;
+	}
+	__put_char(buf, i);
 }
 
-void test_printk(void){
+void __init test_printk(void){
 	char *p="this is %s test";
 	char c='H';
 	int d=-256;
 	int k=0;
+	char buf[8];
 	printk("testing printk\n");
 	
 	printk("test string :::	%s\ntest char ::: %c\ntest digit ::: %d\n \
 			test X ::: %x\ntest unsigned ::: %u\ntest zero ::: %d\n",p,c,d,d,d,k);
+	printk("test width ::: [%5d] [%-5d] [%05d] [%+d] [% d]\n",42,42,-42,42,42);
+	printk("test precision ::: [%.3d] [%8.3s] [%.*s]\n",7,"abcdef",2,"abcdef");
+	printk("test hex ::: [%#x] [%#o] [%08X] [%p]\n",255,8,0xbeef,p);
+	printk("test flags ::: [%05.1d] [%#.3o] [%#.0o] [%#o] [%-#6.3o] (expect "
+		"[   42] [010] [0] [0] [010   ])\n",42,8,0,0,8);
+	printk("test snprintf ::: %d [%s]\n",snprintf(buf,sizeof(buf),"%d",1234567890),buf);
 }
-
@@ -0,0 +1,20 @@
+/* print.h
+ * Kernel formatted output, see print.c
+*/
+
+#ifndef PRINT_H
+#define PRINT_H
+
+#ifdef CONFIG_HOST
+// Built for the host, whose ABI may pass variable arguments in registers
+typedef __builtin_va_list va_list;
+#else
+typedef char * va_list;
+#endif
+
+int vsnprintf(char *buf, int size, const char *fmt, va_list args);
+int snprintf(char *buf, int size, const char *fmt, ...);
+void printk(const char *fmt, ...);
+
+
+#endif // PRINT_H
@@ -1,15 +1,19 @@
 /* proc.c */
 
-/* Process descriptor */ 
-struct task_info {
-	unsigned int sp;	// process stack pointer
-	struct task_info *next;
-};
-
-#define TASK_SIZE	4096 // size of process memory 
-#define current	current_task_info()
-#define disable_schedule(x)	disable_irq()
-#define enable_schedule(x)	enable_irq()
+#include "proc.h"
+#include "interrupt.h"
+#include "memory.h"
+#include "vdso.h"
+#include "file.h"
+#include "exec.h"
+#include "ring.h"
+#include "trace.h"
+#include "initcall.h"
+
+// Set when the running process should give up the CPU, e.g., by the tick
+int need_resched;
+// ID of the next process created; the first process is 0
+static unsigned int next_pid = 1;
 /* Initialize process SP and push process function onto stack.
  * 
  * NOTE
@@ -70,30 +74,70 @@ struct task_info *current_task_info(void)
 	return (struct task_info *)(sp & ~(TASK_SIZE-1));
 }
 
+/* A new process has no open files */
+static void init_files(struct task_info *tsk)
+{
+	int i;
+
+	for(i=0; i<NR_OPEN; i++) {
+		tsk->files[i] = (void *)0;
+	}
+}
+
 /* Initialize the linked list that links together all processes */
-int task_init(void)
+int __init task_init(void)
 {
 	current->next = current;
+	current->state = TASK_RUNNING;
+	current->pid = 0;
+	current->image = (void *)0;
+	init_files(current);
+	vdso_set_task(current->pid);
 	
 	return 0;
 }
 
+/* Check whether the current process is the only runnable one in the system */
+int single_task_running(void)
+{
+	struct task_info *tsk;
+
+	for(tsk=current->next; tsk!=current; tsk=tsk->next) {
+		if(tsk->state == TASK_RUNNING) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
 /* Allocate process memory 
  * 
  * NOTE 
- * To simplify the code, processes are now allocated from addr "task_stack_base" 
- * sequentially, each takes a memory block of TASK_SIZE. 
- *
- * TODO
- * Replace this variable with page allocation function. 
+ * Each process takes a page, TASK_SIZE bytes aligned to its size, from the 
+ * buddy allocator; "struct task_info" is at its low end and the stack above.
 */
-int task_stack_base = 0x30300000;
 struct task_info *copy_task_info(struct task_info *tsk)
 {
-	struct task_info *tmp = (struct task_info *)task_stack_base;
-	task_stack_base += TASK_SIZE;
-	
-	return tmp;
+	return (struct task_info *)get_free_pages(0, 0);
+}
+
+/* Unlink a dead process and free its memory; called with interrupts disabled 
+ * by the scheduler, after it has switched away from the process for good
+ *
+ * NOTE
+ * The scheduler still runs on the stack of the process, which is fine as 
+ * freeing only changes the struct "page"s, and nothing can allocate the page
+ * before the switch.
+ */
+static void release_task(struct task_info *tsk)
+{
+	struct task_info *prev;
+
+	for(prev=tsk; prev->next!=tsk; prev=prev->next);
+	prev->next = tsk->next;
+
+	put_free_pages(tsk, 0);
 }
 
 /* Get the mode of the process that invoked do_fork() */ 
@@ -105,8 +149,11 @@ unsigned int get_cpsr(void)
 	return p;
 }
 
-/* Create a new process 
+/* Create a new process and return its "struct task_info" 
  * 
+ * NOTE
+ * When "f" returns, the process exits with its return value, see do_exit().
+ *
  * Steps:
  * 1) Allocate an memory block to hold all the data of a process
  * 2) Initilize SP of the new process, i.e., member "sp" in "struct task_info"; 
@@ -114,25 +161,84 @@ unsigned int get_cpsr(void)
  * 3) Initilize process function
  * 4) Save PCB (e.g., into a linked list)
 */
-int do_fork(int (*f) (void *), void *args)
+struct task_info *kernel_thread(int (*f) (void *), void *args)
 {
 	struct task_info *tsk, *tmp;
+	unsigned int flags;
 	
 	if((tsk = copy_task_info(current)) == (void *)0) {
-		return -1;
+		return (void *)0;
 	}
 
 	tsk->sp = ((unsigned int)(tsk) + TASK_SIZE);
+	tsk->state = TASK_RUNNING;
+	tsk->image = (void *)0;
+	tsk->exit_code = 0;
+	init_files(tsk);
 
-	DO_INIT_SP(tsk->sp, f, args, 0, 0x1f & get_cpsr(), 0);
+	DO_INIT_SP(tsk->sp, f, args, do_exit, 0x1f & get_cpsr(), 0);
 
-	disable_schedule();
+	flags = local_irq_save();
+	tsk->pid = next_pid++;
 	tmp = current->next;
 	current->next = tsk;
 	tsk->next = tmp;
-	enable_schedule();
+	local_irq_restore(flags);
 
-	return 0;
+	return tsk;
+}
+
+/* Create a new process; the same as kernel_thread() but returns 0 on 
+ * success and -1 on failure 
+ */
+int do_fork(int (*f) (void *), void *args)
+{
+	return kernel_thread(f, args) ? 0 : -1;
+}
+
+/* Make a sleeping process runnable again */
+void wake_up_process(struct task_info *tsk)
+{
+	if(tsk->state == TASK_SLEEPING) {
+		tsk->state = TASK_RUNNING;
+	}
+}
+
+/* Terminate the current process with exit code "code"
+ *
+ * NOTE
+ * 1. Its rings are destroyed, its open files are closed and the app it runs
+ *    is unloaded here; its memory is freed by the scheduler once it has 
+ *    switched to another process, as this function still runs on it.
+ * 2. Process 0 runs plat_boot() and never exits.
+ */
+void do_exit(int code)
+{
+	struct task_info *tsk = current;
+
+	exit_rings(tsk);
+	exit_files(tsk);
+	exit_image(tsk);
+
+	tsk->exit_code = code;
+	tsk->state = TASK_DEAD;
+
+	// If all others are sleeping, the scheduler comes back here
+	while(1) {
+		schedule();
+	}
+}
+
+/* Give up the CPU voluntarily
+ *
+ * NOTE
+ * To sleep, a process sets its state to TASK_SLEEPING before calling it; if
+ * it is woken up in between, it simply stays runnable.
+ */
+void schedule(void)
+{
+	need_resched = 1;
+	__asm_yield();
 }
 
 /* Return the addr of "struct task_info" of the next process
@@ -145,6 +251,29 @@ int do_fork(int (*f) (void *), void *args)
 */
 void *common_schedule(void)
 {
-	return (void *)(current->next);
+	struct task_info *tsk;
+
+	// Only the tick asks for a process switch; other interrupts return to 
+	// the interrupted process
+	if(!need_resched) {
+		return (void *)current;
+	}
+	need_resched = 0;
+
+	// Round robin among runnable processes; if all others are sleeping, keep
+	// running the current one
+	for(tsk=current->next; tsk!=current; tsk=tsk->next) {
+		if(tsk->state == TASK_RUNNING) {
+			trace_printk("sched: %d -> %d, state %d", current->pid, tsk->pid,
+				current->state);
+			if(current->state == TASK_DEAD) {
+				release_task(current);
+			}
+			vdso_set_task(tsk->pid);
+			return (void *)tsk;
+		}
+	}
+
+	return (void *)current;
 }
 
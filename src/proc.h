@@ -0,0 +1,48 @@
+/* proc.h */
+
+#ifndef PROC_H
+#define PROC_H
+
+
+/// Process states
+#define TASK_RUNNING	0	// runnable
+#define TASK_SLEEPING	1	// waiting for wake_up_process()
+#define TASK_DEAD		2	// exited; freed once the scheduler switches away
+
+#define NR_OPEN		16	// max # of open files of a process
+
+struct file;
+struct exec_image;
+
+/* Process descriptor
+ *
+ * NOTE
+ * __asm_schedule accesses member "sp" at offset 0
+ */
+struct task_info {
+	unsigned int sp;	// process stack pointer
+	struct task_info *next;
+	unsigned int state;
+	unsigned int pid;
+	struct file *files[NR_OPEN];	// indexed by file descriptors
+	struct exec_image *image;		// the app run by the process, if any
+	int exit_code;
+};
+
+#define TASK_SIZE	4096 // size of process memory, a page (copy_task_info())
+#define current	current_task_info()
+
+extern int need_resched;
+
+struct task_info *current_task_info(void);
+int task_init(void);
+int single_task_running(void);
+struct task_info *kernel_thread(int (*f) (void *), void *args);
+int do_fork(int (*f) (void *), void *args);
+void wake_up_process(struct task_info *tsk);
+void do_exit(int code);
+void schedule(void);
+void __asm_yield(void);
+
+
+#endif // PROC_H
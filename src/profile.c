@@ -0,0 +1,128 @@
+/* profile.c
+ * Statistical profiler: the tick samples the interrupted PC
+ *
+ * NOTE
+ * 1. Each sample records the interrupted PC, LR and process. LR gives the
+ *    caller of the sampled function most of the time, so host tools can build
+ *    two-level stacks from it.
+ * 2. Samples are stored in a fixed ring buffer; when it is full, the oldest
+ *    samples are overwritten.
+ * 4. A PIE app is loaded at a different addr each time it is spawned, so each
+ *    sample also records the load bias of the app run by the process, see
+ *    exec.c; the tool subtracts it to resolve addrs against the app.
+ * 3. The buffer is dumped over the UART in the following format, and
+ *    tools/profile.py resolves the addrs against kernel.elf and the apps:
+ *        PROFILE BEGIN samples=<n> lost=<n> hz=<n>
+ *        P <task> <pc> <lr> <bias>
+ *        ...
+ *        PROFILE END
+*/
+
+#include "interrupt.h"
+#include "timer.h"
+#include "proc.h"
+#include "uart.h"
+#include "print.h"
+#include "exec.h"
+
+#define PROFILE_BUF_SIZE	2048	// must be a power of 2
+
+struct profile_sample {
+	unsigned int pc;
+	unsigned int lr;
+	unsigned int task;    // addr of "struct task_info" of the sampled process
+	unsigned int bias;    // load bias of the app run by the process, or 0
+};
+
+static struct profile_sample profile_buf[PROFILE_BUF_SIZE];
+static unsigned int profile_head;	// # of samples recorded since the last reset
+int prof_on;
+
+/* Record a sample of the interrupted context; called by the tick */
+void profile_tick(void)
+{
+	struct pt_regs *regs;
+	struct profile_sample *s;
+	struct task_info *tsk;
+
+	if(!prof_on || (regs = get_irq_regs()) == (void *)0) {
+		return;
+	}
+
+	s = &profile_buf[profile_head & (PROFILE_BUF_SIZE-1)];
+	s->pc = regs->pc;
+	s->lr = regs->lr;
+	// The tick runs on the stack of the interrupted process
+	tsk = current_task_info();
+	s->task = (unsigned int)tsk;
+	s->bias = tsk->image ? tsk->image->bias : 0;
+	profile_head++;
+}
+
+/* Discard all samples and start sampling */
+void profile_start(void)
+{
+	unsigned int flags;
+
+	flags = local_irq_save();
+	profile_head = 0;
+	prof_on = 1;
+	local_irq_restore(flags);
+}
+
+void profile_stop(void)
+{
+	prof_on = 0;
+}
+
+/* Print all samples over the UART; sampling is stopped while dumping */
+void profile_dump(void)
+{
+	unsigned int i, n, start, lost;
+	int on = prof_on, polled;
+	struct profile_sample *s;
+
+	prof_on = 0;
+	// The dump is far larger than the TX ring, and may run with interrupts 
+	// disabled, so nothing may be dropped or left queued
+	polled = uart_set_polled(1);
+
+	n = profile_head;
+	lost = 0;
+	if(n > PROFILE_BUF_SIZE) {
+		lost = n - PROFILE_BUF_SIZE;
+		n = PROFILE_BUF_SIZE;
+	}
+	start = profile_head - n;
+
+	printk("PROFILE BEGIN samples=%u lost=%u hz=%u\n", n, lost, HZ);
+	for(i=0; i<n; i++) {
+		s = &profile_buf[(start+i) & (PROFILE_BUF_SIZE-1)];
+		printk("P %x %x %x %x\n", s->task, s->pc, s->lr, s->bias);
+	}
+	printk("PROFILE END\n");
+
+	uart_set_polled(polled);
+	prof_on = on;
+}
+
+#ifdef CONFIG_PROFILE
+static struct timer_list profile_timer;
+
+static void profile_timer_fn(unsigned long data)
+{
+	profile_stop();
+	profile_dump();
+}
+
+/* Profile the system from boot for CONFIG_PROFILE seconds, then dump */
+void profile_boot_init(void)
+{
+	init_timer(&profile_timer);
+	profile_timer.expires = jiffies + CONFIG_PROFILE*HZ;
+	profile_timer.function = profile_timer_fn;
+	add_timer(&profile_timer);
+
+	profile_start();
+}
+#endif
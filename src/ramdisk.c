@@ -1,46 +1,77 @@
 /* ramdisk.c 
  * Device driver for ramdisks
+ *
+ * NOTE
+ * The ramdisk is driven through the block layer, see block.h. A ramdisk is
+ * plain memory, so each request is done with memcpy and completed right away.
 */
 
 #include "storage.h"
+#include "block.h"
+#include "string.h"
+#include "mmu.h"
+#include "initcall.h"
 
+#define RAMDISK_PHYS_ADDR		0x30800000
+#define RAMDISK_VIRT_ADDR		0x40800000
+#define RAMDISK_SIZE			(2*1024*1024)
 #define RAMDISK_SECTOR_SIZE		512
 #define RAMDISK_SECTOR_MASK	    (~(RAMDISK_SECTOR_SIZE-1))
 #define RAMDISK_SECTOR_OFFSET	((RAMDISK_SECTOR_SIZE-1))
 
-// memcpy is defined in print.c	
-extern void *memcpy(void *dest, const void *src, unsigned int count);
+static struct request_queue ramdisk_queue;
 
-/* Read contents from ramdisk 
- * 
- * @Parameters: sd is pointer to the ramdisk; dest is pointer to the
- *  memory addr that data should be copied to; addr is the offset of 
- *  the data to be read; size is the size of data to be read.
+/* Do all the queued requests of the ramdisk
+ *
+ * NOTE
+ * The bios of a request are contiguous in the device, so the device addr
+ * simply advances from one segment to the next.
 */
-int ramdisk_dout(struct storage_device *sd, 
-				 void *dest, unsigned int addr, size_t size)
+static void ramdisk_request_fn(struct request_queue *q)
 {
-	memcpy(dest, (char *)(addr+sd->start_pos), size);
+	struct storage_device *sd = q->sd;
+	struct request *rq;
+	struct bio *bio;
+	struct bio_vec *bv;
+	char *addr;
+	int i;
 
-	return 0;
+	while((rq = blk_fetch_request(q))) {
+		addr = (char *)(sd->start_pos + rq->pos);
+
+		rq_for_each_segment(bv, rq, bio, i) {
+			if(rq->dir == READ) {
+				memcpy(bv->buf, addr, bv->len);
+			} else {
+				memcpy(addr, bv->buf, bv->len);
+			}
+			addr += bv->len;
+		}
+
+		blk_end_request(q, rq, 0);
+	}
 }
 
 struct storage_device ramdisk_storage_device = {
-	.start_pos = 0x40800000,
+	.start_pos = RAMDISK_VIRT_ADDR,
+	.phys_pos = RAMDISK_PHYS_ADDR,
 	.sector_size = RAMDISK_SECTOR_SIZE,
-	.storage_size = 2*1024*1024,
-	.dout = ramdisk_dout,
+	.storage_size = RAMDISK_SIZE,
+	.dout = blk_dout,
+	.din = blk_din,
 };
 
 /* Initialize the ramdisk */
-int ramdisk_driver_init(void)
+int __init ramdisk_driver_init(void)
 {
 	int ret;
 	
-	remap_l1(0x30800000, 0x40800000, 2*1024*1024);
+	remap_l1(RAMDISK_PHYS_ADDR, RAMDISK_VIRT_ADDR, RAMDISK_SIZE);
+
+	blk_init_queue(&ramdisk_queue, ramdisk_request_fn, &ramdisk_storage_device);
 	
 	ret = register_storage_device(&ramdisk_storage_device, RAMDISK);
 	
 	return ret;
 }
-
+device_initcall(ramdisk_driver_init);
@@ -0,0 +1,413 @@
+/* ring.c
+ * Kernel side of the submission/completion rings, see ring.h
+ *
+ * NOTE
+ * 1. The shared memory can be changed by the process at any time, so the
+ *    kernel keeps its own copy of the ring geometry in "struct ring_ctx" and
+ *    never trusts the sizes and offsets found in the shared header.
+ * 2. A ring belongs to the process that set it up; only that process can use
+ *    or destroy it, and the rings it still holds are destroyed when it exits.
+ * 3. A ring is referenced by "ring_ctxs" and by each __NR_ring_enter running
+ *    on it, so it is freed only after the last of them has put it.
+*/
+
+#include "ring.h"
+#include "proc.h"
+#include "timer.h"
+#include "memory.h"
+#include "string.h"
+#include "interrupt.h"
+
+#define NULL ((void *)0)
+
+// Max # of rings in the system
+#define RING_MAX_NR				8
+// Jiffies the polling kernel process spins without work before sleeping
+#define RING_SQ_THREAD_IDLE		(HZ/10)
+
+#define RING_HDR_SIZE	((sizeof(struct ring)+31)&~31)
+
+// Marks a slot of "ring_ctxs" taken by a ring being set up
+#define RING_RESERVED	((struct ring_ctx *)1)
+
+struct ring_ctx {
+	struct ring *ring;            // shared memory
+	unsigned int sq_entries;
+	unsigned int cq_entries;
+	struct ring_sqe *sqes;
+	struct ring_cqe *cqes;
+	int order;                    // the shared memory is 2^order pages
+	unsigned int setup_flags;
+	struct task_info *owner;      // the process that set it up
+	unsigned int users;           // # of references, see NOTE 3
+	struct task_info *sq_thread;  // the polling kernel process
+	volatile int sq_thread_stop;
+	volatile int sq_thread_exited;
+};
+
+static struct ring_ctx *ring_ctxs[RING_MAX_NR];
+
+/* Find ring "id" of the current process; interrupts must be disabled */
+static struct ring_ctx *ring_lookup(int id)
+{
+	struct ring_ctx *ctx;
+
+	if(id < 0 || id >= RING_MAX_NR) {
+		return NULL;
+	}
+
+	ctx = ring_ctxs[id];
+	if(ctx == NULL || ctx == RING_RESERVED || ctx->owner != current) {
+		return NULL;
+	}
+
+	return ctx;
+}
+
+/* Check whether system call "opcode" may be run from ring "ctx"
+ *
+ * NOTE
+ * 1. Rings cannot be managed from inside a ring.
+ * 2. __NR_exit would end the process running the SQEs, i.e., the polling 
+ *    kernel process or the caller of __NR_ring_enter, in the middle of a 
+ *    batch whose CQEs are never posted.
+ * 3. File descriptors belong to a process. The SQEs of a RING_SETUP_SQPOLL
+ *    ring are run by the polling kernel process, whose descriptors mean
+ *    nothing to the process that set up the ring, so the system calls on 
+ *    descriptors are refused there.
+ */
+static int ring_opcode_allowed(struct ring_ctx *ctx, unsigned int opcode)
+{
+	switch(opcode) {
+	case __NR_ring_setup:
+	case __NR_ring_enter:
+	case __NR_ring_destroy:
+	case __NR_exit:
+		return 0;
+	case __NR_open:
+	case __NR_read:
+	case __NR_write:
+	case __NR_lseek:
+	case __NR_close:
+		return !(ctx->setup_flags & RING_SETUP_SQPOLL);
+	default:
+		return 1;
+	}
+}
+
+/* Run up to "to_submit" queued SQEs and post their results
+ *
+ * NOTE
+ * Submission stops early when the completion ring is full, so that no
+ * result is lost; the remaining SQEs are run by a later call.
+ *
+ * Return value: # of SQEs consumed
+ */
+static int ring_submit_sqes(struct ring_ctx *ctx, unsigned int to_submit)
+{
+	struct ring *r = ctx->ring;
+	struct ring_sqe *sqe;
+	struct ring_cqe *cqe;
+	unsigned int head, tail, opcode, user_data, n = 0;
+	int args[6], res, i;
+
+	head = r->sq_head;
+	tail = r->sq_tail;
+	ring_barrier();
+
+	// The tail is written by the process; never run more than a full ring
+	if(tail - head > ctx->sq_entries) {
+		tail = head + ctx->sq_entries;
+	}
+
+	while(head != tail && n < to_submit) {
+		if(r->cq_tail - r->cq_head >= ctx->cq_entries) {
+			break;
+		}
+
+		/// Copy the SQE first, since the process may change it meanwhile
+		sqe = &ctx->sqes[head & (ctx->sq_entries-1)];
+		opcode = sqe->opcode;
+		user_data = sqe->user_data;
+		for(i=0; i<6; i++) {
+			args[i] = sqe->args[i];
+		}
+
+		if(!ring_opcode_allowed(ctx, opcode)) {
+			res = -1;
+		} else {
+			res = sys_call_schedule(opcode, args);
+		}
+
+		cqe = &ctx->cqes[r->cq_tail & (ctx->cq_entries-1)];
+		cqe->user_data = user_data;
+		cqe->res = res;
+		ring_barrier();
+		r->cq_tail++;
+
+		head++;
+		r->sq_head = head;
+		n++;
+	}
+
+	return n;
+}
+
+/* The kernel process that polls the submission ring (RING_SETUP_SQPOLL) */
+static int ring_sq_thread(void *data)
+{
+	struct ring_ctx *ctx = (struct ring_ctx *)data;
+	struct ring *r = ctx->ring;
+	unsigned long idle_end = jiffies + RING_SQ_THREAD_IDLE;
+
+	while(!ctx->sq_thread_stop) {
+		if(ring_submit_sqes(ctx, ctx->sq_entries)) {
+			idle_end = jiffies + RING_SQ_THREAD_IDLE;
+			continue;
+		}
+
+		if(time_before(jiffies, idle_end)) {
+			schedule();
+			continue;
+		}
+
+		/// Nothing to do for a while; sleep until __NR_ring_enter wakes us up
+		current->state = TASK_SLEEPING;
+		r->flags |= RING_SQ_NEED_WAKEUP;
+		ring_barrier();
+		// SQEs queued before the process could see the flag
+		if(r->sq_head != r->sq_tail || ctx->sq_thread_stop) {
+			current->state = TASK_RUNNING;
+		} else {
+			schedule();
+		}
+		r->flags &= ~RING_SQ_NEED_WAKEUP;
+		idle_end = jiffies + RING_SQ_THREAD_IDLE;
+	}
+
+	ctx->sq_thread_exited = 1;
+
+	// Returning exits the thread
+	return 0;
+}
+
+/* Free a ring; its polling kernel process must have stopped */
+static void ring_free(struct ring_ctx *ctx)
+{
+	put_free_pages(ctx->ring, ctx->order);
+	kfree(ctx);
+}
+
+/* Find ring "id" of the current process and take a reference to it */
+static struct ring_ctx *ring_get(int id)
+{
+	struct ring_ctx *ctx;
+	unsigned int flags;
+
+	flags = local_irq_save();
+	if((ctx = ring_lookup(id)) != NULL) {
+		ctx->users++;
+	}
+	local_irq_restore(flags);
+
+	return ctx;
+}
+
+/* Drop a reference to a ring, and free it on the last one */
+static void ring_put(struct ring_ctx *ctx)
+{
+	unsigned int flags, users;
+
+	flags = local_irq_save();
+	users = --ctx->users;
+	local_irq_restore(flags);
+
+	if(users == 0) {
+		ring_free(ctx);
+	}
+}
+
+/* System Call: create a ring
+ *
+ * @Parameters: "entries" is the # of SQEs, rounded up to a power of 2;
+ *  "flags" are RING_SETUP_XXX; "ringp" receives the addr of the shared memory.
+ *
+ * Return value: ring ID, or -1
+ */
+int __syscall_ring_setup(unsigned int entries, unsigned int flags, struct ring **ringp)
+{
+	struct ring_ctx *ctx;
+	struct ring *r;
+	unsigned int size, sq_entries, irq_flags;
+	int id, order;
+
+	if(entries == 0 || entries > RING_MAX_ENTRIES || ringp == NULL) {
+		return -1;
+	}
+	for(sq_entries=1; sq_entries<entries; sq_entries<<=1);
+
+	/// Take a slot first, as the allocations below may switch processes
+	irq_flags = local_irq_save();
+	for(id=0; id<RING_MAX_NR && ring_ctxs[id]; id++);
+	if(id < RING_MAX_NR) {
+		ring_ctxs[id] = RING_RESERVED;
+	}
+	local_irq_restore(irq_flags);
+	if(id == RING_MAX_NR) {
+		return -1;
+	}
+
+	if((ctx = (struct ring_ctx *)kmalloc(sizeof(struct ring_ctx))) == NULL) {
+		ring_ctxs[id] = NULL;
+		return -1;
+	}
+	memset(ctx, 0, sizeof(struct ring_ctx));
+
+	size = RING_HDR_SIZE + sq_entries*sizeof(struct ring_sqe) +
+			2*sq_entries*sizeof(struct ring_cqe);
+	for(order=0; (PAGE_SIZE<<order) < size; order++);
+
+	if((r = (struct ring *)get_free_pages(0, order)) == NULL) {
+		kfree(ctx);
+		ring_ctxs[id] = NULL;
+		return -1;
+	}
+	memset(r, 0, PAGE_SIZE<<order);
+
+	r->sq_entries = sq_entries;
+	r->cq_entries = 2*sq_entries;
+	r->sqes_off = RING_HDR_SIZE;
+	r->cqes_off = RING_HDR_SIZE + sq_entries*sizeof(struct ring_sqe);
+
+	ctx->ring = r;
+	ctx->sq_entries = r->sq_entries;
+	ctx->cq_entries = r->cq_entries;
+	ctx->sqes = (struct ring_sqe *)((char *)r + r->sqes_off);
+	ctx->cqes = (struct ring_cqe *)((char *)r + r->cqes_off);
+	ctx->order = order;
+	ctx->setup_flags = flags;
+	ctx->owner = current;
+	ctx->users = 1;
+
+	if(flags & RING_SETUP_SQPOLL) {
+		if((ctx->sq_thread = kernel_thread(ring_sq_thread, ctx)) == NULL) {
+			ring_free(ctx);
+			ring_ctxs[id] = NULL;
+			return -1;
+		}
+	}
+
+	ring_ctxs[id] = ctx;
+	*ringp = r;
+
+	return id;
+}
+
+/* System Call: run queued SQEs and/or wait for completions
+ *
+ * @Parameters: "to_submit" is the max # of SQEs to run; with RING_ENTER_GETEVENTS,
+ *  wait until there are "min_complete" CQEs. It fails at once if more CQEs
+ *  are asked for than the completion ring holds, or than the CQEs posted and
+ *  SQEs queued so far will give.
+ *
+ * NOTE
+ * Without RING_SETUP_SQPOLL, SQEs are run right here, so all completions are
+ * available on return and there is nothing to wait for. With it, SQEs are
+ * run by the polling kernel process only.
+ *
+ * Return value: # of SQEs consumed by this call, or -1
+ */
+int __syscall_ring_enter(int id, unsigned int to_submit, unsigned int min_complete, unsigned int flags)
+{
+	struct ring_ctx *ctx;
+	struct ring *r;
+	unsigned int queued;
+	int submitted = 0;
+
+	if((ctx = ring_get(id)) == NULL) {
+		return -1;
+	}
+	r = ctx->ring;
+
+	if(ctx->setup_flags & RING_SETUP_SQPOLL) {
+		if(flags & RING_ENTER_SQ_WAKEUP) {
+			wake_up_process(ctx->sq_thread);
+		}
+
+		if(flags & RING_ENTER_GETEVENTS) {
+			/// Never wait for more CQEs than the queued SQEs and the ring can give
+			queued = r->sq_tail - r->sq_head;
+			if(queued > ctx->sq_entries) {
+				queued = ctx->sq_entries;
+			}
+			if(min_complete > ctx->cq_entries ||
+					min_complete > r->cq_tail - r->cq_head + queued) {
+				ring_put(ctx);
+				return -1;
+			}
+			while(r->cq_tail - r->cq_head < min_complete) {
+				// The ring is being destroyed; no more CQEs will come
+				if(ctx->sq_thread_stop) {
+					submitted = -1;
+					break;
+				}
+				if(r->flags & RING_SQ_NEED_WAKEUP) {
+					wake_up_process(ctx->sq_thread);
+				}
+				schedule();
+			}
+		}
+	} else {
+		submitted = ring_submit_sqes(ctx, to_submit);
+	}
+
+	ring_put(ctx);
+
+	return submitted;
+}
+
+/* System Call: destroy a ring
+ *
+ * NOTE
+ * The ring is taken off "ring_ctxs" at once, but freed only when the calls
+ * still running on it are done, see NOTE 3.
+ */
+int __syscall_ring_destroy(int id)
+{
+	struct ring_ctx *ctx;
+	unsigned int flags;
+
+	flags = local_irq_save();
+	if((ctx = ring_lookup(id)) != NULL) {
+		ring_ctxs[id] = NULL;
+	}
+	local_irq_restore(flags);
+	if(ctx == NULL) {
+		return -1;
+	}
+
+	if(ctx->sq_thread) {
+		ctx->sq_thread_stop = 1;
+		wake_up_process(ctx->sq_thread);
+		while(!ctx->sq_thread_exited) {
+			schedule();
+		}
+	}
+
+	ring_put(ctx);
+
+	return 0;
+}
+
+/* Destroy the rings of process "tsk"; called when it exits */
+void exit_rings(struct task_info *tsk)
+{
+	int id;
+
+	for(id=0; id<RING_MAX_NR; id++) {
+		if(ring_ctxs[id] && ring_ctxs[id] != RING_RESERVED &&
+				ring_ctxs[id]->owner == tsk) {
+			__syscall_ring_destroy(id);
+		}
+	}
+}
@@ -0,0 +1,151 @@
+/* ring.h
+ * Submission/completion rings shared by a process and the kernel
+ *
+ * NOTE
+ * 1. A process queues system call requests (SQEs) into the submission ring,
+ *    and issues a single __NR_ring_enter system call to have the kernel run
+ *    all of them; each result is posted as a CQE into the completion ring.
+ * 2. With RING_SETUP_SQPOLL, a kernel process polls the submission ring, so
+ *    requests are run without any system call. After it has found nothing to
+ *    do for a while, it sets RING_SQ_NEED_WAKEUP in "flags" and sleeps, and
+ *    __NR_ring_enter with RING_ENTER_SQ_WAKEUP wakes it up. The requests 
+ *    are then run by that kernel process, so system calls on file 
+ *    descriptors fail with -1 on such rings.
+ * 3. The process only writes sq_tail and cq_head; the kernel only writes
+ *    sq_head, cq_tail and flags. Indices run freely and wrap at 2^32.
+*/
+
+#ifndef RING_H
+#define RING_H
+
+#include "syscall.h"
+
+
+/// Flags of __NR_ring_setup
+#define RING_SETUP_SQPOLL		0x1
+
+/// Flags of __NR_ring_enter
+#define RING_ENTER_GETEVENTS	0x1		// wait for "min_complete" completions
+#define RING_ENTER_SQ_WAKEUP	0x2		// wake up the polling kernel process
+
+/// Bits in "flags" of struct ring
+#define RING_SQ_NEED_WAKEUP		0x1
+
+#define RING_MAX_ENTRIES		128
+
+// Submission queue entry: a system call request
+struct ring_sqe {
+	unsigned int opcode;      // system call ID
+	int args[6];              // arguments, as passed in R0~R5
+	unsigned int user_data;   // copied into the CQE as is
+};
+
+// Completion queue entry: the result of a request
+struct ring_cqe {
+	unsigned int user_data;
+	int res;                  // return value of the system call
+};
+
+// Header of the shared memory; SQEs and CQEs follow it
+struct ring {
+	volatile unsigned int sq_head;
+	volatile unsigned int sq_tail;
+	volatile unsigned int cq_head;
+	volatile unsigned int cq_tail;
+	volatile unsigned int flags;
+	unsigned int sq_entries;      // a power of 2
+	unsigned int cq_entries;      // twice sq_entries
+	unsigned int sqes_off;        // offset of the SQE array from the header
+	unsigned int cqes_off;        // offset of the CQE array from the header
+};
+
+#define RING_SQE(r,i)	((struct ring_sqe *)((char *)(r)+(r)->sqes_off) + ((i)&((r)->sq_entries-1)))
+#define RING_CQE(r,i)	((struct ring_cqe *)((char *)(r)+(r)->cqes_off) + ((i)&((r)->cq_entries-1)))
+
+// Keep the compiler from reordering accesses to the rings; one CPU only
+#define ring_barrier()	asm volatile ("":::"memory")
+
+
+/* ----------------- User-space helpers ------------------------ */
+
+/* Create a ring of "entries" SQEs; "*ringp" is set to the shared memory
+ *
+ * Return value: ring ID used by the other calls, or -1
+ */
+static inline int ring_setup(unsigned int entries, unsigned int flags, struct ring **ringp)
+{
+	return syscall3(__NR_ring_setup, entries, flags, ringp);
+}
+
+static inline int ring_destroy(int id)
+{
+	return syscall1(__NR_ring_destroy, id);
+}
+
+/* Get a free SQE, or NULL if the submission ring is full */
+static inline struct ring_sqe *ring_get_sqe(struct ring *r)
+{
+	if(r->sq_tail - r->sq_head >= r->sq_entries) {
+		return (void *)0;
+	}
+
+	return RING_SQE(r, r->sq_tail);
+}
+
+/* Make the SQE got by ring_get_sqe() visible to the kernel */
+static inline void ring_queue_sqe(struct ring *r)
+{
+	ring_barrier();
+	r->sq_tail++;
+}
+
+/* Have the kernel run the queued SQEs, waiting for "min_complete" CQEs
+ *
+ * NOTE
+ * With RING_SETUP_SQPOLL, no system call is made unless the polling kernel
+ * process needs to be woken up or the caller has to wait.
+ */
+static inline int ring_submit(int id, struct ring *r, unsigned int min_complete, int sqpoll)
+{
+	unsigned int flags = min_complete ? RING_ENTER_GETEVENTS : 0;
+	unsigned int to_submit = r->sq_tail - r->sq_head;
+
+	if(sqpoll) {
+		ring_barrier();
+		if(r->flags & RING_SQ_NEED_WAKEUP) {
+			flags |= RING_ENTER_SQ_WAKEUP;
+		} else if(!min_complete) {
+			return to_submit;
+		}
+		to_submit = 0;
+	}
+
+	return syscall4(__NR_ring_enter, id, to_submit, min_complete, flags);
+}
+
+/* Get the oldest CQE, or NULL if there is none */
+static inline struct ring_cqe *ring_peek_cqe(struct ring *r)
+{
+	ring_barrier();
+	if(r->cq_head == r->cq_tail) {
+		return (void *)0;
+	}
+
+	return RING_CQE(r, r->cq_head);
+}
+
+/* Give back the CQE got by ring_peek_cqe() */
+static inline void ring_cqe_seen(struct ring *r)
+{
+	ring_barrier();
+	r->cq_head++;
+}
+
+
+/* ----------------- Kernel ------------------------------------ */
+
+struct task_info;
+void exit_rings(struct task_info *tsk);
+
+
+#endif // RING_H
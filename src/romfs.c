@@ -3,6 +3,11 @@
 #include "fs.h"
 #include "storage.h"
 #include "string.h"
+#include "memory.h"
+#include "bcache.h"
+#include "util_list.h"
+#include "initcall.h"
+#include "print.h"
 
 
 #define NULL (void *)0
@@ -47,132 +52,230 @@ struct super_block romfs_super_block;
 #define romfs_get_file_data_offset(p,num)	(((((num)+ROMFS_NAME_ALIGN_SIZE)&ROMFS_NAME_MASK)+ROMFS_SUPER_UP_MARGIN+(p)))
 
 
-/* Remove the toppest dir in a path name */
-static char *bmap(char *tmp, char *dir) 
+/// Types of files, in the low 3 bits of "next" of a file header
+#define ROMFS_TYPE_MASK		0x7
+#define ROMFS_TYPE_HARDLINK	0
+#define ROMFS_TYPE_DIR		1
+
+#define ROMFS_MAX_PATH		256
+#define ROMFS_MAX_DEPTH		16
+#define ROMFS_HASH_SIZE		128		// a power of 2
+#define ROMFS_HDR_SIZE		(sizeof(struct romfs_inode)+ROMFS_MAX_FILE_NAME)
+
+/* An entry of the directory index
+ *
+ * NOTE
+ * Hard links are resolved when the index is built, so "hdr" and "name" are 
+ * those of the file header that holds the data.
+ */
+struct romfs_dentry {
+	struct list_head hash;
+	char *path;             // full path, without a leading '/'
+	char *name;             // name in the file header at "hdr"
+	unsigned int hdr;       // offset of the file header
+	unsigned int size;
+	unsigned int spec;
+	unsigned int type;
+};
+
+static struct list_head romfs_hash[ROMFS_HASH_SIZE];
+static unsigned int romfs_nr_dentries;
+
+static unsigned int romfs_hashfn(const char *path)
 {
-	unsigned int n;
-	char *p=strchr(dir,'/');
-	if(!p){
-		strcpy(tmp,dir);
+	unsigned int h = 0;
+
+	while(*path) {
+		h = h*31 + *path++;
+	}
+
+	return h & (ROMFS_HASH_SIZE-1);
+}
+
+/* Read the file header at offset "off" into "p"; the name is always ended */
+static int __init romfs_read_header(struct super_block *block, struct romfs_inode *p, unsigned int off)
+{
+	if(bcache_read(block->device, p, off, ROMFS_HDR_SIZE)) {
+		return -1;
+	}
+	p->name[ROMFS_MAX_FILE_NAME-1] = '\0';
+
+	return 0;
+}
+
+/* Add the entry described by file header "p" at offset "off" as "path" */
+static struct romfs_dentry * __init romfs_add_dentry(struct super_block *block, 
+				struct romfs_inode *p, unsigned int off, char *path)
+{
+	struct romfs_dentry *de;
+	unsigned int next = be32_to_le32(p->next);
+	unsigned int len = strlen(path);
+
+	if((de = (struct romfs_dentry *)kmalloc(sizeof(struct romfs_dentry))) == NULL) {
+		return NULL;
+	}
+	if((de->path = (char *)kmalloc(len+1)) == NULL) {
+		kfree(de);
 		return NULL;
 	}
-	n=p-dir;
-	n=(n>ROMFS_MAX_FILE_NAME)?ROMFS_MAX_FILE_NAME:n;
-	strncpy(tmp,dir,n);
-	return p+1;
+	strcpy(de->path, path);
+	de->name = de->path + len - strlen(p->name);
+
+	/// A hard link takes everything from the header it points to
+	if((next & ROMFS_TYPE_MASK) == ROMFS_TYPE_HARDLINK) {
+		off = be32_to_le32(p->spec) & ROMFS_NEXT_MASK;
+		if(romfs_read_header(block, p, off) ||
+			(de->name = (char *)kmalloc(strlen(p->name)+1)) == NULL) {
+			kfree(de->path);
+			kfree(de);
+			return NULL;
+		}
+		strcpy(de->name, p->name);
+		next = be32_to_le32(p->next);
+	}
+
+	de->hdr = off;
+	de->size = be32_to_le32(p->size);
+	de->spec = be32_to_le32(p->spec);
+	de->type = next & ROMFS_TYPE_MASK;
+
+	list_add(&de->hash, &romfs_hash[romfs_hashfn(de->path)]);
+	romfs_nr_dentries++;
+
+	return de;
 }
 
-/* Get the file name without path */
-static char *get_the_file_name(char *p, char *name)
+/* Index all entries of the directory whose first file header is at "off"
+ *
+ * @Parameters: "path" holds the path of the directory, "len" chars long, 
+ *  and is used to build the paths of its entries; "p" is a buffer for file 
+ *  headers.
+ */
+static int __init romfs_index_dir(struct super_block *block, struct romfs_inode *p,
+				unsigned int off, char *path, unsigned int len, int depth)
 {
-	char *tmp=p;
-	int index;
-	
-	for(index=0; *tmp; tmp++) {
-		if(*tmp=='/') {
-			index=0;
+	struct romfs_dentry *de;
+	unsigned int next, n;
+
+	if(depth > ROMFS_MAX_DEPTH) {
+		return -1;
+	}
+
+	for(; off != 0; off = next & ROMFS_NEXT_MASK) {
+		if(off >= block->device->storage_size || romfs_read_header(block, p, off)) {
+			return -1;
+		}
+		next = be32_to_le32(p->next);
+
+		if(!strcmp(p->name, ".") || !strcmp(p->name, "..")) {
 			continue;
+		}
+
+		n = strlen(p->name);
+		if(len + n + 2 > ROMFS_MAX_PATH) {
+			continue;
+		}
+		if(len) {
+			path[len] = '/';
+			strcpy(path+len+1, p->name);
 		} else {
-			name[index] = *tmp;
-			index++;
+			strcpy(path, p->name);
+		}
+
+		if((de = romfs_add_dentry(block, p, off, path)) == NULL) {
+			return -1;
 		}
+
+		/// The header buffer is reused below, so "next" is kept in a local
+		if(de->type == ROMFS_TYPE_DIR && de->spec) {
+			if(romfs_index_dir(block, p, de->spec & ROMFS_NEXT_MASK, path, 
+					strlen(de->path), depth+1)) {
+				return -1;
+			}
+		}
+		path[len] = '\0';
 	}
-	
-	name[index]='\0';
-	
-	return name;
+
+	return 0;
 }
 
-/* Given the name of a file, get its inode */
-struct inode *simple_romfs_namei(struct super_block *block, char *dir)
+/* Build the directory index of the whole file system
+ *
+ * NOTE
+ * It is done once at romfs_init(), so that namei() is a single hash probe 
+ * however many files and dirs there are.
+ */
+static int __init romfs_build_index(struct super_block *block)
 {
-	struct inode *inode;
 	struct romfs_inode *p;
-	unsigned int tmp,next,num;
-	char name[ROMFS_MAX_FILE_NAME], fname[ROMFS_MAX_FILE_NAME];
-	unsigned int max_p_size = ROMFS_MAX_FILE_NAME + sizeof(struct romfs_inode);
-	max_p_size = max_p_size>(block->device->sector_size) ? max_p_size : (block->device->sector_size);
-	
-	// fname is the file name without paths
-	get_the_file_name(dir,fname);
-	
-	if((p=(struct romfs_inode *)kmalloc(max_p_size,0))==NULL){
-		goto ERR_OUT_NULL;
+	char *path;
+	int i, ret = -1;
+
+	for(i=0; i<ROMFS_HASH_SIZE; i++) {
+		INIT_LIST_HEAD(&romfs_hash[i]);
 	}
-	
-	dir=bmap(name,dir);
-	
-	if(block->device->dout(block->device,p,0,block->device->sector_size))
-		goto ERR_OUT_KMALLOC;
-	// Get the addr of the first file (file header + file data)	
-	next = romfs_get_first_file_header(p);
-
-	while(1){
-		tmp=(be32_to_le32(next))&ROMFS_NEXT_MASK;
-		if(tmp>=block->device->storage_size)
-			goto ERR_OUT_KMALLOC;
-		if(tmp!=0){
-			if(block->device->dout(block->device,p,tmp,block->device->sector_size)){
-				goto ERR_OUT_KMALLOC;
-			}
-			if(!strcmp(p->name,name)){
-				if(!strcmp(name,fname)){
-					goto FOUND;
-				}else{
-					dir=bmap(name,dir);
-					next=p->spec;	
-					if(dir==NULL){
-						goto FOUNDDIR;
-					}
-				}
-			}else{
-				next=p->next;	
-			}
-		}else{
-			goto ERR_OUT_KMALLOC;
-		}
+
+	if((p = (struct romfs_inode *)kmalloc(ROMFS_HDR_SIZE)) == NULL) {
+		return -1;
+	}
+	if((path = (char *)kmalloc(ROMFS_MAX_PATH)) == NULL) {
+		goto OUT;
 	}
+	path[0] = '\0';
 
-FOUNDDIR:
-	while(1){
-		tmp=(be32_to_le32(next))&ROMFS_NEXT_MASK;
+	/// The super block is followed by the first file header of the root
+	if(romfs_read_header(block, p, 0) == 0) {
+		ret = romfs_index_dir(block, p, 
+				be32_to_le32(romfs_get_first_file_header(p)) & ROMFS_NEXT_MASK, 
+				path, 0, 0);
+	}
 
-		if(tmp!=0){
-			if(block->device->dout(block->device,p,tmp,block->device->sector_size)){
-				goto ERR_OUT_KMALLOC;
-			}
+	kfree(path);
+OUT:
+	kfree(p);
+	return ret;
+}
 
-			if(!strcmp(p->name,name)){
-				goto FOUND;
-			}else{
-				next=p->next;
-			}
-		}else{
-			goto ERR_OUT_KMALLOC;
+/* Given the path of a file, get its inode
+ *
+ * NOTE
+ * 1. The path is relative to the root of the file system; leading '/'s are 
+ *    ignored.
+ * 2. The inode comes from the inode cache; drop it with iput().
+ */
+struct inode *simple_romfs_namei(struct super_block *block, char *dir)
+{
+	struct inode *inode;
+	struct romfs_dentry *de = NULL;
+	struct list_head *pos;
+
+	while(*dir == '/') {
+		dir++;
+	}
+
+	list_for_each(pos, &romfs_hash[romfs_hashfn(dir)]) {
+		if(!strcmp(list_entry(pos, struct romfs_dentry, hash)->path, dir)) {
+			de = list_entry(pos, struct romfs_dentry, hash);
+			break;
 		}
 	}
+	if(de == NULL) {
+		return NULL;
+	}
 
-FOUND:
-	if((inode = (struct inode *)kmalloc(sizeof(struct inode), 0))==NULL){
-		goto ERR_OUT_KMALLOC;
+	/// Cached by the offset of the file header, so hard links share an inode
+	if((inode = iget_locked(block, de->hdr)) == NULL) {
+		return NULL;
 	}
-	num=strlen(p->name);				
-	if((inode->name=(char *)kmalloc(num,0))==NULL){
-		goto ERR_OUT_KMEM_CACHE_ALLOC;
+	if(inode->state & I_NEW) {
+		inode->name = de->name;
+		inode->flags = de->type;
+		inode->dsize = de->size;
+		inode->daddr = de->hdr;
+		unlock_new_inode(inode);
 	}
-	strcpy(inode->name,p->name);	
-	inode->dsize=be32_to_le32(p->size);
-	inode->daddr=tmp;			
-	inode->super=&romfs_super_block;
-	kfree(p);		
-	return inode;
 
-ERR_OUT_KMEM_CACHE_ALLOC:
-	kfree(inode);
-ERR_OUT_KMALLOC:
-	kfree(p);
-ERR_OUT_NULL:
-	return NULL;
+	return inode;
 }
 
 /* Given a file's inode, get the addr of the file's data */
@@ -182,22 +285,60 @@ unsigned int romfs_get_daddr(struct inode *node)
 	return romfs_get_file_data_offset(node->daddr, name_size);
 }
 
+/* Read "size" bytes at offset "pos" of a file through the buffer cache */
+int romfs_read(struct inode *node, void *buf, unsigned int pos, size_t size)
+{
+	if(pos >= node->dsize) {
+		return 0;
+	}
+	if(size > node->dsize - pos) {
+		size = node->dsize - pos;
+	}
+
+	if(bcache_read(node->super->device, buf, romfs_get_daddr(node) + pos, size)) {
+		return -1;
+	}
+
+	return size;
+}
+
+/* Start reading "size" bytes at offset "pos" of a file into the buffer cache */
+void romfs_readahead(struct inode *node, unsigned int pos, size_t size)
+{
+	if(pos >= node->dsize) {
+		return;
+	}
+	if(size > node->dsize - pos) {
+		size = node->dsize - pos;
+	}
+
+	bcache_readahead(node->super->device, romfs_get_daddr(node) + pos, size);
+}
+
 // struct "super_block" for romfs file system 
 struct super_block romfs_super_block = {
 	.namei = simple_romfs_namei,
 	.get_daddr = romfs_get_daddr,
+	.read = romfs_read,
+	.readahead = romfs_readahead,
 	.name = "romfs",
 };
 
 /* Initialize romfs file system */
-int romfs_init(void) 
+int __init romfs_init(void) 
 {
 	int ret;
 	
 	ret = register_file_system(&romfs_super_block, ROMFS);
 	
 	romfs_super_block.device = storage[RAMDISK];
+
+	if(romfs_build_index(&romfs_super_block)) {
+		printk("romfs: cannot index the file system\n");
+	}
+	printk("romfs: %d entries indexed\n", romfs_nr_dentries);
 	
 	return ret;
 }
+fs_initcall(romfs_init);
 
@@ -15,15 +15,23 @@
 
 typedef unsigned int size_t;
 
+struct request_queue;
+
 // Description of a generic stroage device
 struct storage_device {
 	unsigned int start_pos; 
+	// Physical addr of a device that is plain memory, e.g., a ramdisk, so 
+	// that its data can be mapped in place; 0 otherwise
+	unsigned int phys_pos;
 	size_t sector_size;     // size of the minimum storage unit
 	size_t storage_size;    // size of the storage device 
 	
 	/// Function pointers to functions that write data to/read data from device	
 	int (*dout)(struct storage_device *sd, void *dest, unsigned int bias, size_t size);
 	int (*din)(struct storage_device *sd, void *dest, unsigned int  bias, size_t size);
+	
+	// Request queue of the device, see block.h
+	struct request_queue *queue;
 };
 
 extern struct storage_device *storage[MAX_STORAGE_DEVICE];
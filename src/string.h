@@ -3,21 +3,11 @@
 #ifndef STRING_H
 #define STRING_H
 
-static inline int strcmp(const char * cs,const char * ct){
-	register signed char __res;
-	while (1) {
-		if ((__res = *cs - *ct++) != 0 || !*cs++)
-			break;
-	}
-	return __res;
-}
-
-static inline void * memset(void * s,int c,unsigned int count){
-	char *xs = (char *) s;
-	while (count--)
-		*xs++ = c;
-	return s;
-}
+/// Implemented in string.s, see the NOTE there
+void *memcpy(void *dest, const void *src, unsigned int count);
+void *memset(void *s, int c, unsigned int count);
+unsigned int strlen(const char *s);
+int strcmp(const char *cs, const char *ct);
 
 static inline char * strcpy(char * dest,const char *src){
 	char *tmp = dest;
@@ -31,10 +21,10 @@ static inline char * strncpy(char * dest,const char *src,unsigned int count){
 	return tmp;
 }
 
-static inline unsigned int strlen(const char * s){
-	const char *sc;
-	for (sc = s; *sc != '\0'; ++sc);
-	return sc - s;
+static inline int strncmp(const char *cs, const char *ct, unsigned int count){
+	signed char res = 0;
+	while (count-- && (res = *cs - *ct++) == 0 && *cs++);
+	return res;
 }
 
 static inline char * strchr(const char * s, int c){
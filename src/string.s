@@ -0,0 +1,220 @@
+/* string.s
+ * Memory and string routines optimized for ARM920T
+ *
+ * NOTE
+ * 1. memcpy and memset first align the destination to a word, then move 32
+ *    bytes (memcpy: 16 bytes when the source is not word aligned) per
+ *    ldm/stm burst, then single words, and finally the remaining bytes.
+ * 2. When the source of memcpy is not word aligned, aligned words are
+ *    loaded and shifted together, so no unaligned loads are done.
+ * 3. strlen and strcmp scan a word at a time. A word has a zero byte iff
+ *    (w-0x01010101) & ~w & 0x80808080 is not 0. Aligned words never cross a
+ *    page, so reading past the end of a string within its last word is safe.
+*/
+
+.syntax unified
+
+.global memcpy
+.global memset
+.global strlen
+.global strcmp
+
+.text
+.code 32
+
+## void *memcpy(void *dest, const void *src, unsigned int count)
+memcpy:
+	stmfd r13!,{r0,r4-r10,r14}
+	cmp r2,#16
+	blo .Lcpy_bytes
+
+	## Align the destination
+1:
+	tst r0,#3
+	beq 2f
+	ldrb r3,[r1],#1
+	strb r3,[r0],#1
+	sub r2,r2,#1
+	b 1b
+2:
+	ands r12,r1,#3
+	bne .Lcpy_unaligned
+
+	## Both aligned: 32 bytes per burst, then words
+	subs r2,r2,#32
+	blo 4f
+3:
+	ldmia r1!,{r3-r10}
+	stmia r0!,{r3-r10}
+	subs r2,r2,#32
+	bhs 3b
+4:
+	adds r2,r2,#28
+	blo 6f
+5:
+	ldr r3,[r1],#4
+	str r3,[r0],#4
+	subs r2,r2,#4
+	bhs 5b
+6:
+	add r2,r2,#4
+
+.Lcpy_bytes:
+	subs r2,r2,#1
+	ldrbhs r3,[r1],#1
+	strbhs r3,[r0],#1
+	bhs .Lcpy_bytes
+	ldmfd r13!,{r0,r4-r10,pc}
+
+	## Source not aligned: R12 = right shift, R14 = left shift, R3 holds the
+	## aligned word whose upper bytes come next
+.Lcpy_unaligned:
+	bic r1,r1,#3
+	mov r12,r12,lsl #3
+	rsb r14,r12,#32
+	ldr r3,[r1],#4
+	subs r2,r2,#16
+	blo 8f
+7:
+	ldmia r1!,{r4-r7}
+	mov r3,r3,lsr r12
+	orr r3,r3,r4,lsl r14
+	mov r4,r4,lsr r12
+	orr r4,r4,r5,lsl r14
+	mov r5,r5,lsr r12
+	orr r5,r5,r6,lsl r14
+	mov r6,r6,lsr r12
+	orr r6,r6,r7,lsl r14
+	stmia r0!,{r3-r6}
+	mov r3,r7
+	subs r2,r2,#16
+	bhs 7b
+8:
+	adds r2,r2,#12
+	blo 10f
+9:
+	ldr r4,[r1],#4
+	mov r3,r3,lsr r12
+	orr r3,r3,r4,lsl r14
+	str r3,[r0],#4
+	mov r3,r4
+	subs r2,r2,#4
+	bhs 9b
+10:
+	add r2,r2,#4
+	# Back to the real source addr: the unused bytes of R3
+	sub r1,r1,#4
+	add r1,r1,r12,lsr #3
+	b .Lcpy_bytes
+
+## void *memset(void *s, int c, unsigned int count)
+memset:
+	stmfd r13!,{r0,r4-r9,r14}
+	and r1,r1,#0xff
+	orr r1,r1,r1,lsl #8
+	orr r1,r1,r1,lsl #16
+	cmp r2,#16
+	blo .Lset_bytes
+
+	## Align the destination
+1:
+	tst r0,#3
+	beq 2f
+	strb r1,[r0],#1
+	sub r2,r2,#1
+	b 1b
+2:
+	mov r3,r1
+	mov r4,r1
+	mov r5,r1
+	mov r6,r1
+	mov r7,r1
+	mov r8,r1
+	mov r9,r1
+	subs r2,r2,#32
+	blo 4f
+3:
+	stmia r0!,{r1,r3-r9}
+	subs r2,r2,#32
+	bhs 3b
+4:
+	adds r2,r2,#28
+	blo 6f
+5:
+	str r1,[r0],#4
+	subs r2,r2,#4
+	bhs 5b
+6:
+	add r2,r2,#4
+
+.Lset_bytes:
+	subs r2,r2,#1
+	strbhs r1,[r0],#1
+	bhs .Lset_bytes
+	ldmfd r13!,{r0,r4-r9,pc}
+
+## unsigned int strlen(const char *s)
+strlen:
+	mov r1,r0
+	## Bytes up to a word boundary
+1:
+	tst r1,#3
+	beq 2f
+	ldrb r2,[r1],#1
+	cmp r2,#0
+	bne 1b
+	b 4f
+2:
+	ldr r12,=0x01010101
+3:
+	ldr r2,[r1],#4
+	sub r3,r2,r12
+	bic r3,r3,r2
+	tst r3,r12,lsl #7
+	beq 3b
+	## The word has a zero byte; find it
+	sub r1,r1,#4
+5:
+	ldrb r2,[r1],#1
+	cmp r2,#0
+	bne 5b
+4:
+	sub r0,r1,r0
+	sub r0,r0,#1
+	mov pc,r14
+
+## int strcmp(const char *cs, const char *ct)
+strcmp:
+	orr r12,r0,r1
+	tst r12,#3
+	bne .Lcmp_bytes
+
+	## Both aligned: compare words until they differ or have a zero byte
+	ldr r12,=0x01010101
+1:
+	ldr r2,[r0],#4
+	ldr r3,[r1],#4
+	cmp r2,r3
+	bne 2f
+	sub r3,r2,r12
+	bic r3,r3,r2
+	tst r3,r12,lsl #7
+	beq 1b
+	mov r0,#0
+	mov pc,r14
+	## Find the first different byte in the words
+2:
+	sub r0,r0,#4
+	sub r1,r1,#4
+
+.Lcmp_bytes:
+	ldrb r2,[r0],#1
+	ldrb r3,[r1],#1
+	# Carry is clear iff R2 is 0, which ends the string
+	cmp r2,#1
+	cmpcs r2,r3
+	beq .Lcmp_bytes
+	sub r0,r2,r3
+	mov pc,r14
+
+.ltorg
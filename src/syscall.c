@@ -1,39 +1,119 @@
 /* syscall.c */
 
 #include "syscall.h"
+#include "trace.h"
+#include "print.h"
+
+void profile_start(void);
+void profile_stop(void);
+void profile_dump(void);
+
+/* Unused system call IDs */
+static int __syscall_ni(void)
+{
+	return -1;
+}
 
 // Regiestered System Calls
-syscall_fn syscall_table[__NR_SYS_CALL] = {
-	(syscall_fn)__syscall_test,
+// NOTE  __vector_swi jumps through this table without checking for NULL
+syscall_fn syscall_table[__NR_SYSCALL_MAX] = {
+	[0 ... __NR_SYSCALL_MAX-1] = (syscall_fn)__syscall_ni,
+	[__NR_test] = (syscall_fn)__syscall_test,
+	[__NR_profile] = (syscall_fn)__syscall_profile,
+	[__NR_null] = (syscall_fn)__syscall_null,
+	[__NR_ring_setup] = (syscall_fn)__syscall_ring_setup,
+	[__NR_ring_enter] = (syscall_fn)__syscall_ring_enter,
+	[__NR_ring_destroy] = (syscall_fn)__syscall_ring_destroy,
+	[__NR_open] = (syscall_fn)__syscall_open,
+	[__NR_read] = (syscall_fn)__syscall_read,
+	[__NR_write] = (syscall_fn)__syscall_write,
+	[__NR_lseek] = (syscall_fn)__syscall_lseek,
+	[__NR_close] = (syscall_fn)__syscall_close,
+	[__NR_spawn] = (syscall_fn)__syscall_spawn,
+	[__NR_exit] = (syscall_fn)__syscall_exit,
 };
 
-/* System Call Interface 
- * 
+/* Record system call "index" with its first 3 arguments in the trace
+ *
+ * NOTE
+ * Called only when tracing is on, by __vector_swi for system calls made by
+ * SWI, and by sys_call_schedule() for those made from the kernel, e.g., by
+ * the rings.
+ */
+void syscall_trace(unsigned int index, int a0, int a1, int a2)
+{
+	trace_printk("syscall: %u (%x, %x, %x)", index, a0, a1, a2);
+}
+
+/* System Call Interface for kernel code
+ *
  * @Parameters:
- * 	index: system call ID; num: # of parameters; 
- * 	args: addr of parameters array. 
+ * 	index: system call ID; args: addr of an array of the 6 arguments
+ *  that would have been passed in R0~R5.
 */
-int sys_call_schedule(unsigned int index, int num, int *args)
+int sys_call_schedule(unsigned int index, int *args)
 {
-	if(syscall_table[index]) {
-		return (syscall_table[index])(num,args);
+	if(trace_on) {
+		syscall_trace(index, args[0], args[1], args[2]);
+	}
+	if(index < __NR_SYSCALL_MAX) {
+		return (syscall_table[index])(args[0], args[1], args[2],
+										args[3], args[4], args[5]);
 	}
-	
+
 	return -1;
 }
 
 /* System Call 0 */
-syscall_fn __syscall_test(int index,int *array)
+int __syscall_test(int index,int *array)
 {
 	printk("Kernel message: printed by __syscall_test\n");
-	
+
 	int i;
 	for(i=0; i<index; i++) {
 		printk("  Argument %d:  %x\n",i, array[i]);
 	}
 
-	
+
 	return 0;
 }
 
+/* System Call 1: control the statistical profiler and the event tracer
+ *
+ * args[0] is one of PROFILE_CMD_XXX
+*/
+int __syscall_profile(int num, int *args)
+{
+	if(num < 1) { return -1; }
+
+	switch(args[0]) {
+		case PROFILE_CMD_STOP:
+			profile_stop();
+			break;
+		case PROFILE_CMD_START:
+			profile_start();
+			break;
+		case PROFILE_CMD_DUMP:
+			profile_dump();
+			break;
+		case PROFILE_CMD_TRACE_STOP:
+			trace_stop();
+			break;
+		case PROFILE_CMD_TRACE_START:
+			trace_start();
+			break;
+		case PROFILE_CMD_TRACE_DUMP:
+			trace_dump();
+			break;
+		default:
+			return -1;
+	}
 
+	return 0;
+}
+
+/* System Call 2: do nothing; used to measure the system call overhead */
+int __syscall_null(void)
+{
+	return 0;
+}
@@ -6,48 +6,110 @@
 
 #define __NR_SYSCALL_BASE	0x0
 #define __NR_test           (__NR_SYSCALL_BASE+0)
-#define __NR_SYS_CALL       (__NR_SYSCALL_BASE+1)
-
-
-// Type of system call function
-typedef int (*syscall_fn)(int num, int *args);
-
-
-/* An user-space macro to set up system call environment 
- * 
- * NOTE 
- * 1. The structure of "do { } while(0)" ensures that the macro can be 
- *    compiled successfully under all circumstances.
- * 
- * 2. How can user-space program pass parameters to kernel-space system call functions?
- *    Unsuitable solutions: Procedure Call Standard: # of available registers is limited; 
- *      Variable arguments: high overhead.
- *    A compromised solution: Converting all parameters into 32-bit ints, which are stored
- *      into an array; passing to kernel the addr of array and its size.
- * 
- * 3. All code in the macro is run in user space. Thus, array addr "parry" and its size 
- *    "pnum" are pushed onto the stack of "user" mode. But since "user mode" and "sys" mode
- *    use the same stack, so kernel can seamlessly access any data of "user" mode.
+#define __NR_profile        (__NR_SYSCALL_BASE+1)
+#define __NR_null           (__NR_SYSCALL_BASE+2)
+#define __NR_ring_setup     (__NR_SYSCALL_BASE+3)
+#define __NR_ring_enter     (__NR_SYSCALL_BASE+4)
+#define __NR_ring_destroy   (__NR_SYSCALL_BASE+5)
+#define __NR_open           (__NR_SYSCALL_BASE+6)
+#define __NR_read           (__NR_SYSCALL_BASE+7)
+#define __NR_write          (__NR_SYSCALL_BASE+8)
+#define __NR_lseek          (__NR_SYSCALL_BASE+9)
+#define __NR_close          (__NR_SYSCALL_BASE+10)
+#define __NR_spawn          (__NR_SYSCALL_BASE+11)
+#define __NR_exit           (__NR_SYSCALL_BASE+12)
+#define __NR_SYS_CALL       (__NR_SYSCALL_BASE+13)
+
+// Size of syscall_table; also checked against by __vector_swi (abnormal.S)
+#define __NR_SYSCALL_MAX    64
+
+/// Commands of __NR_profile, passed as the first parameter
+#define PROFILE_CMD_STOP    0
+#define PROFILE_CMD_START   1
+#define PROFILE_CMD_DUMP    2
+#define PROFILE_CMD_TRACE_STOP	3	// the same for the event tracer (trace.c)
+#define PROFILE_CMD_TRACE_START	4
+#define PROFILE_CMD_TRACE_DUMP	5
+
+
+// The rest is C; abnormal.S only takes the numbers above
+#ifndef __ASSEMBLER__
+
+// Type of system call function; it gets the arguments passed in R0~R5
+typedef int (*syscall_fn)(int a0, int a1, int a2, int a3, int a4, int a5);
+
+
+/* User-space functions to invoke a system call
+ *
+ * NOTE
+ * 1. System call ID is passed in R7 and up to 6 arguments in R0~R5, which are
+ *    exactly where the kernel handler gets its arguments, so nothing is copied
+ *    on the way. The return value is in R0.
+ *
+ * 2. "mov lr,pc" puts the addr of the instr after SWI into LR (PC reads 8 bytes
+ *    ahead), so __vector_swi returns to LR without saving the return addr of
+ *    "svc" mode. Thus, R12 and LR are clobbered by system calls, and so are 
+ *    R1~R3, as the handler is a C function and __vector_swi does not save 
+ *    them; R4 and R5 are restored.
+ *
+ * 3. System calls that take many parameters can still convert them into 32-bit
+ *    ints stored in an array, and pass the array addr and its size, as
+ *    SYSCALL() does.
 */
+static inline int __syscall6(int num, int a0, int a1, int a2, int a3, int a4, int a5)
+{
+	register int r0 asm("r0") = a0;
+	register int r1 asm("r1") = a1;
+	register int r2 asm("r2") = a2;
+	register int r3 asm("r3") = a3;
+	register int r4 asm("r4") = a4;
+	register int r5 asm("r5") = a5;
+	register int r7 asm("r7") = num;
+
+	asm volatile (
+		"mov lr,pc\n\t"
+		"swi #0\n\t"
+		:"+r"(r0),"+r"(r1),"+r"(r2),"+r"(r3)
+		:"r"(r4),"r"(r5),"r"(r7)
+		:"r12","lr","cc","memory"
+	);
+
+	return r0;
+}
+
+#define syscall0(num)					__syscall6((num),0,0,0,0,0,0)
+#define syscall1(num,a0)				__syscall6((num),(int)(a0),0,0,0,0,0)
+#define syscall2(num,a0,a1)				__syscall6((num),(int)(a0),(int)(a1),0,0,0,0)
+#define syscall3(num,a0,a1,a2)			__syscall6((num),(int)(a0),(int)(a1),(int)(a2),0,0,0)
+#define syscall4(num,a0,a1,a2,a3)		__syscall6((num),(int)(a0),(int)(a1),(int)(a2),(int)(a3),0,0)
+#define syscall5(num,a0,a1,a2,a3,a4)	__syscall6((num),(int)(a0),(int)(a1),(int)(a2),(int)(a3),(int)(a4),0)
+#define syscall6(num,a0,a1,a2,a3,a4,a5)	__syscall6((num),(int)(a0),(int)(a1),(int)(a2),(int)(a3),(int)(a4),(int)(a5))
+
+/* Invoke system call "num" with "pnum" parameters stored in array "parray" */
 #define SYSCALL(num,pnum,parray,ret)  do { \
-	asm volatile ( \
-		"stmfd r13!,{%3}\n"  \
-		"stmfd r13!,{%2}\n"  \
-		"sub r13,r13,#4\n"  \
-		"swi %1\n"		    \
-		"ldmfd r13!,{%0}\n" \
-		"add r13,r13,#8\n"  \
-		:"=r"(ret)			\
-		:"i"(num),"r"(pnum),"r"(parray)	\
-		:"r2","r3" \
-	); \
+	(ret) = syscall2((num), (pnum), (parray)); \
 } while(0)
 
 
-int sys_call_schedule(unsigned int index, int num, int *args);
-syscall_fn __syscall_test(int index,int *array);
+extern syscall_fn syscall_table[__NR_SYSCALL_MAX];
+int sys_call_schedule(unsigned int index, int *args);
+void syscall_trace(unsigned int index, int a0, int a1, int a2);
+int __syscall_test(int num, int *array);
+int __syscall_profile(int num, int *args);
+int __syscall_null(void);
+struct ring;
+int __syscall_ring_setup(unsigned int entries, unsigned int flags, struct ring **ringp);
+int __syscall_ring_enter(int id, unsigned int to_submit, unsigned int min_complete, unsigned int flags);
+int __syscall_ring_destroy(int id);
+int __syscall_open(const char *path, int flags);
+int __syscall_read(int fd, void *buf, unsigned int size);
+int __syscall_write(int fd, const void *buf, unsigned int size);
+int __syscall_lseek(int fd, int offset, int whence);
+int __syscall_close(int fd);
+int __syscall_spawn(const char *path);
+int __syscall_exit(int code);
 
-
-#endif // SYSCALL_H
+#endif // __ASSEMBLER__
 
 
+#endif // SYSCALL_H
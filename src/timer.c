@@ -1,24 +1,435 @@
-/* timer.c */
+/* timer.c
+ * Drivers of s3c2410's PWM timers and kernel time keeping
+ *
+ * NOTE
+ * 1. Timer 3 runs freely as the clocksource, and timer 4 is the clockevent
+ *    device that generates the tick. Both are 16-bit down counters, so the
+ *    clocksource has to be read at least once every 0x10000 cycles to keep
+ *    track of its wraps; the tick and max_delta of timer 4 make sure of it.
+ * 2. Timers 2, 3 and 4 share prescaler 1. With PCLK at 50MHz, prescaler 1
+ *    gives 2MHz; divided by 2, timer 3 counts at 1MHz (1us per cycle, wraps
+ *    every 65ms), and divided by 16, timer 4 counts at 125KHz.
+*/
 
-void timer_init(void){
+#include "timer.h"
+#include "interrupt.h"
+#include "proc.h"
+#include "vdso.h"
+#include "initcall.h"
+#include "print.h"
 
+#define TIMER_PHYS_BASE	(0x51000000)
 #define TIMER_BASE  (0xd1000000)
 #define TCFG0   ((volatile unsigned int *)(TIMER_BASE+0x0))
 #define TCFG1   ((volatile unsigned int *)(TIMER_BASE+0x4))
 #define TCON    ((volatile unsigned int *)(TIMER_BASE+0x8))
+#define TCNTB3  ((volatile unsigned int *)(TIMER_BASE+0x30))
+#define TCMPB3  ((volatile unsigned int *)(TIMER_BASE+0x34))
+#define TCNTO3  ((volatile unsigned int *)(TIMER_BASE+0x38))
+#define TCNTO3_PHYS	(TIMER_PHYS_BASE+0x38)
 #define TCONB4  ((volatile unsigned int *)(TIMER_BASE+0x3c))
-	
-	*TCFG0 |= 0x800;
-	*TCON &= (~(7<<20));
-	*TCON |= (1<<22);
-	*TCON |= (1<<21);
+#define TCNTO4  ((volatile unsigned int *)(TIMER_BASE+0x40))
 
-	*TCONB4 = 10000;
+/// Bits of timer 3 and timer 4 in TCON
+#define TCON_T3_START		(1<<16)
+#define TCON_T3_UPDATE		(1<<17)
+#define TCON_T3_RELOAD		(1<<19)
+#define TCON_T3_MASK		(0xf<<16)
+#define TCON_T4_START		(1<<20)
+#define TCON_T4_UPDATE		(1<<21)
+#define TCON_T4_RELOAD		(1<<22)
+#define TCON_T4_MASK		(0x7<<20)
 
-	*TCON |= (1<<20);
-	*TCON &= ~(1<<21);
+#define TIMER_PCLK			50000000
+#define TIMER_PRESCALER1	24		// input of timers 2~4: PCLK/(24+1)=2MHz
+#define TCFG1_DIV2			0x0
+#define TCFG1_DIV16			0x3
+#define TCFG1_MUX3_SHIFT	12
+#define TCFG1_MUX4_SHIFT	16
 
-	umask_int(14);
-	enable_irq();
+#define TIMER_INPUT_FREQ	(TIMER_PCLK/(TIMER_PRESCALER1+1))
+
+void profile_tick(void);
+
+volatile unsigned long jiffies;
+int tick_nohz_enabled = 1;
+
+/* ----------------- clocksource: timer 3 ------------------------ */
+
+/* Timer 3 counts down, so its complement counts up */
+static unsigned int s3c_timer3_read(struct clocksource *cs)
+{
+	return (~(*TCNTO3)) & cs->mask;
+}
+
+struct clocksource s3c_timer3_clocksource = {
+	.name = "timer3",
+	.freq = TIMER_INPUT_FREQ/2,
+	.mask = 0xffff,
+	.read = s3c_timer3_read,
+};
+
+static struct clocksource *clock = &s3c_timer3_clocksource;
+
+static unsigned int cs_last;				// raw count at the last read
+static unsigned long long cs_cycles;		// cycles elapsed up to cs_last
+
+/* Calculate mult and shift so that to_unit = (from_unit*mult)>>shift,
+ * keeping as much precision as mult, a 32-bit int, can hold
+ */
+static void clocks_calc_mult_shift(unsigned int *mult, unsigned int *shift,
+				unsigned int from, unsigned long long to)
+{
+	unsigned long long tmp;
+	unsigned int sft;
+
+	for(sft=32; sft>0; sft--) {
+		tmp = (to << sft) / from;
+		if((tmp >> 32) == 0) { break; }
+	}
+
+	*mult = (unsigned int)tmp;
+	*shift = sft;
+}
+
+static void __init s3c_timer3_start(void)
+{
+	*TCNTB3 = 0xffff;
+	*TCMPB3 = 0;
+	*TCON &= ~TCON_T3_MASK;
+	*TCON |= TCON_T3_UPDATE | TCON_T3_RELOAD;
+	*TCON |= TCON_T3_START;
+	*TCON &= ~TCON_T3_UPDATE;
+}
+
+/* Get the # of clocksource cycles since boot
+ *
+ * NOTE
+ * The counter is only 16 bits wide; each read accumulates the cycles
+ * elapsed since the previous read into a 64-bit count.
+ */
+unsigned long long clocksource_cycles(void)
+{
+	unsigned long long ret;
+	unsigned int flags, now;
+
+	flags = local_irq_save();
+	now = clock->read(clock);
+	cs_cycles += (now - cs_last) & clock->mask;
+	cs_last = now;
+	ret = cs_cycles;
+	local_irq_restore(flags);
+
+	return ret;
+}
+
+/* Get the counting frequency of the clocksource in Hz */
+unsigned int clocksource_freq(void)
+{
+	return clock->freq;
+}
+
+/* Convert clocksource cycles into ns
+ *
+ * NOTE
+ * The cycles are split at "shift" bits so that the products never overflow
+ */
+unsigned long long cycles_to_ns(unsigned long long cycles)
+{
+	unsigned long long hi = cycles >> clock->shift;
+	unsigned long long lo = cycles & ((1ULL << clock->shift) - 1);
+
+	return hi*clock->mult + ((lo*clock->mult) >> clock->shift);
+}
+
+/* Get the time since boot in ns */
+unsigned long long ktime_get_ns(void)
+{
+	return cycles_to_ns(clocksource_cycles());
+}
+
+/* ----------------- clockevent: timer 4 ------------------------ */
+
+static void s3c_timer4_set_mode(struct clock_event_device *ce, unsigned int mode)
+{
+	*TCON &= ~TCON_T4_MASK;
+
+	if(mode == CLOCK_EVT_MODE_PERIODIC) {
+		*TCONB4 = ce->freq / HZ;
+		*TCON |= TCON_T4_UPDATE | TCON_T4_RELOAD;
+		*TCON |= TCON_T4_START;
+		*TCON &= ~TCON_T4_UPDATE;
+	}
+
+	ce->mode = mode;
+}
+
+static int s3c_timer4_set_next_event(struct clock_event_device *ce, unsigned int cycles)
+{
+	*TCON &= ~TCON_T4_MASK;
+	*TCONB4 = cycles;
+	*TCON |= TCON_T4_UPDATE;
+	*TCON |= TCON_T4_START;
+	*TCON &= ~TCON_T4_UPDATE;
+
+	return 0;
+}
+
+struct clock_event_device s3c_timer4_clockevent = {
+	.name = "timer4",
+	.mode = CLOCK_EVT_MODE_UNUSED,
+	.freq = TIMER_INPUT_FREQ/16,
+	.min_delta = 2,
+	// Must expire before the clocksource wraps
+	.max_delta = (TIMER_INPUT_FREQ/16)/20,
+	.set_mode = s3c_timer4_set_mode,
+	.set_next_event = s3c_timer4_set_next_event,
+};
+
+static struct clock_event_device *tick_device = &s3c_timer4_clockevent;
+
+/* Program the clockevent device to fire "delta" ns later */
+static int clockevents_program_event(struct clock_event_device *ce, unsigned long long delta)
+{
+	unsigned long long cycles = (delta * ce->mult) >> ce->shift;
+
+	if(cycles < ce->min_delta) { cycles = ce->min_delta; }
+	if(cycles > ce->max_delta) { cycles = ce->max_delta; }
+
+	return ce->set_next_event(ce, (unsigned int)cycles);
+}
+
+static void s3c_timer4_interrupt(unsigned int irq)
+{
+	tick_device->event_handler(tick_device);
+}
+
+/* ----------------- tick ------------------------ */
+
+static unsigned long long tick_next_period;	// time of the next jiffy (ns)
+static int tick_stopped;
+
+/* Account all the jiffies that have passed by "now" */
+static void tick_do_update_jiffies(unsigned long long now)
+{
+	while(now >= tick_next_period) {
+		jiffies++;
+		tick_next_period += TICK_NSEC;
+	}
 }
 
+/* Account the jiffies passed and refresh the vDSO clocksource snapshot
+ *
+ * NOTE
+ * It runs with interrupts disabled, so "cs_last" is the counter value at "now"
+ */
+static void tick_update(void)
+{
+	unsigned long long now = ktime_get_ns();
+
+	tick_do_update_jiffies(now);
+	update_vsyscall(cs_last, now);
+}
+
+/* Work done on each tick, periodic or one-shot */
+static void tick_sched_handle(void)
+{
+	tick_update();
+	profile_tick();
+	run_timers();
+	need_resched = 1;
+}
+
+static void tick_handle_periodic(struct clock_event_device *ce)
+{
+	tick_sched_handle();
+}
+
+/* Handler of the one-shot event programmed by tick_nohz_idle_enter() 
+ *
+ * NOTE
+ * The same work as a periodic tick; the next event is programmed by 
+ * cpu_idle(), which runs again after it.
+ */
+static void tick_handle_oneshot(struct clock_event_device *ce)
+{
+	tick_sched_handle();
+}
+
+/* Stop the periodic tick and sleep until the next timer is due
+ *
+ * NOTE
+ * 1. If the next timer is at most one jiffy away, the tick keeps running.
+ * 2. Timers are run at jiffy boundaries, so the one-shot event is programmed
+ *    to the boundary of the jiffy of the next timer. Events further than the
+ *    max_delta of the clockevent device are reached in several steps.
+ * 3. It should be called with interrupts disabled, and again after each 
+ *    wakeup while idle, so that the next event is programmed.
+ */
+void tick_nohz_idle_enter(void)
+{
+	unsigned long long now = ktime_get_ns();
+	unsigned long next;
+
+	tick_do_update_jiffies(now);
+
+	next = get_next_timer_interrupt();
+	if(!time_after(next, jiffies + 1)) {
+		// Already stopped: the next jiffy is just one more event
+		if(tick_stopped) {
+			clockevents_program_event(tick_device, tick_next_period - now);
+		}
+		return;
+	}
+
+	tick_device->event_handler = tick_handle_oneshot;
+	tick_device->set_mode(tick_device, CLOCK_EVT_MODE_ONESHOT);
+	// tick_next_period is the boundary of jiffy "jiffies+1"
+	clockevents_program_event(tick_device,
+		tick_next_period + (unsigned long long)(next - jiffies - 1) * TICK_NSEC - now);
+	tick_stopped = 1;
+}
+
+/* Restart the periodic tick after an idle period */
+void tick_nohz_idle_exit(void)
+{
+	unsigned int flags;
+
+	flags = local_irq_save();
+	if(tick_stopped) {
+		tick_do_update_jiffies(ktime_get_ns());
+		tick_device->event_handler = tick_handle_periodic;
+		tick_device->set_mode(tick_device, CLOCK_EVT_MODE_PERIODIC);
+		tick_stopped = 0;
+	}
+	local_irq_restore(flags);
+}
+
+/* Wait for interrupt in the low power state of ARM920T */
+static void cpu_do_idle(void)
+{
+	asm volatile (
+		"mov r0,#0\n\t"
+		"mcr p15,0,r0,c7,c0,4\n\t"
+		:::"r0","memory"
+	);
+}
+
+/* The loop of process 0 once it has nothing else to do
+ *
+ * NOTE
+ * 1. The tick can only be stopped when no other process is runnable; 
+ *    otherwise it is still needed to switch to them, so the CPU is given to 
+ *    them instead.
+ * 2. The tick stays stopped across wakeups, e.g., by the one-shot event or 
+ *    the UART, as long as no other process has become runnable; each time 
+ *    the next event is programmed again.
+ * 3. The ARM920T leaves the wait-for-interrupt state on an IRQ even if it is
+ *    masked; it is taken once interrupts are enabled again.
+ */
+void cpu_idle(void)
+{
+	unsigned int flags;
+
+	while(1) {
+		flags = local_irq_save();
+		while(single_task_running()) {
+			if(tick_nohz_enabled) {
+				tick_nohz_idle_enter();
+			}
+			cpu_do_idle();
+			local_irq_restore(flags);
+			flags = local_irq_save();
+		}
+		local_irq_restore(flags);
+
+		tick_nohz_idle_exit();
+		schedule();
+	}
+}
+
+/* ----------------- delay ------------------------ */
+
+// # of __delay() loops per us, in units of 1/2^32 loop
+static unsigned long long loops_per_usec;
+
+/* Busy loop; each iteration takes the same time */
+static void __delay(unsigned int loops)
+{
+	asm volatile (
+		"1:\n\t"
+		"subs %0,%0,#1\n\t"
+		"bhi 1b\n\t"
+		:"+r"(loops)
+		:
+		:"cc"
+	);
+}
+
+/* Measure the speed of __delay() against the clocksource
+ *
+ * NOTE
+ * The # of loops doubles until it takes at least 1ms, which is long enough
+ * for an accurate result and far shorter than a wrap of the clocksource.
+ */
+static void __init calibrate_delay(void)
+{
+	unsigned long long t0, t1, loops_per_sec;
+	unsigned int loops;
+
+	for(loops=1024; ; loops<<=1) {
+		t0 = clocksource_cycles();
+		__delay(loops);
+		t1 = clocksource_cycles();
+
+		if(t1 - t0 >= clock->freq/1000) { break; }
+	}
+
+	loops_per_sec = ((unsigned long long)loops * clock->freq) / (t1 - t0);
+	loops_per_usec = (loops_per_sec << 32) / 1000000;
+
+	printk("Calibrating delay loop: %d loops per ms\n", (int)(loops_per_sec/1000));
+}
+
+/* Delay for "usecs" us */
+void udelay(unsigned int usecs)
+{
+	__delay((unsigned int)((usecs * loops_per_usec) >> 32) + 1);
+}
+
+/* Delay for "msecs" ms */
+void mdelay(unsigned int msecs)
+{
+	while(msecs--) {
+		udelay(1000);
+	}
+}
+
+/* Initialize the clocksource, calibrate the delay loop, and start the tick */
+void __init timer_init(void){
+	struct clock_event_device *ce = tick_device;
+
+	*TCFG0 = (*TCFG0 & ~(0xff<<8)) | (TIMER_PRESCALER1<<8);
+	*TCFG1 = (*TCFG1 & ~(0xff<<TCFG1_MUX3_SHIFT)) |
+		(TCFG1_DIV2<<TCFG1_MUX3_SHIFT) | (TCFG1_DIV16<<TCFG1_MUX4_SHIFT);
+
+	/// The clocksource
+	clocks_calc_mult_shift(&clock->mult, &clock->shift, clock->freq, NSEC_PER_SEC);
+	s3c_timer3_start();
+	cs_last = clock->read(clock);
+	// Timer 3 counts down
+	vdso_set_clocksource(clock, TCNTO3_PHYS, 1);
+	update_vsyscall(cs_last, 0);
+
+	calibrate_delay();
+
+	/// The tick
+	init_timers();
+	clocks_calc_mult_shift(&ce->mult, &ce->shift, NSEC_PER_SEC, ce->freq);
+	tick_next_period = ktime_get_ns() + TICK_NSEC;
+	ce->event_handler = tick_handle_periodic;
+	ce->set_mode(ce, CLOCK_EVT_MODE_PERIODIC);
+
+	request_irq(IRQ_TIMER4, s3c_timer4_interrupt);
+	enable_irq();
+}
@@ -0,0 +1,100 @@
+/* timer.h
+ *
+ * NOTE
+ * Time is kept by two kinds of devices, modeled after Linux:
+ * 1. A clocksource is a free-running counter that is read to know what time
+ *    it is. Its cycles are converted to ns by (cycles*mult)>>shift.
+ * 2. A clockevent device generates an interrupt after a given number of its
+ *    cycles, either periodically (the tick) or once (tickless idle).
+*/
+
+#ifndef TIMER_H
+#define TIMER_H
+
+#include "util_list.h"
+
+#define HZ				100		// # of ticks per second
+#define NSEC_PER_SEC	1000000000ULL
+#define NSEC_PER_MSEC	1000000ULL
+#define NSEC_PER_USEC	1000ULL
+#define TICK_NSEC		(NSEC_PER_SEC/HZ)
+
+// Description of a free-running counter
+struct clocksource {
+	char *name;
+	unsigned int freq;      // counting frequency in Hz
+	unsigned int mask;      // valid bits of the value returned by "read"
+	unsigned int mult;      // ns = (cycles*mult)>>shift
+	unsigned int shift;
+	// Return the current count; it increases and wraps at "mask"
+	unsigned int (*read)(struct clocksource *cs);
+};
+
+/// Modes of clockevent devices
+#define CLOCK_EVT_MODE_UNUSED	0
+#define CLOCK_EVT_MODE_PERIODIC	1
+#define CLOCK_EVT_MODE_ONESHOT	2
+
+// Description of a programmable interrupt source
+struct clock_event_device {
+	char *name;
+	unsigned int mode;
+	unsigned int freq;      // counting frequency in Hz
+	unsigned int mult;      // cycles = (ns*mult)>>shift
+	unsigned int shift;
+	unsigned int min_delta; // min # of cycles that can be programmed
+	unsigned int max_delta; // max # of cycles that can be programmed
+
+	void (*set_mode)(struct clock_event_device *ce, unsigned int mode);
+	// Generate an interrupt after "cycles" cycles (one-shot mode)
+	int (*set_next_event)(struct clock_event_device *ce, unsigned int cycles);
+	// Called from the interrupt handler of the device
+	void (*event_handler)(struct clock_event_device *ce);
+};
+
+// # of ticks since boot
+extern volatile unsigned long jiffies;
+// Tickless idle is used when it is not 0
+extern int tick_nohz_enabled;
+
+void timer_init(void);
+unsigned long long clocksource_cycles(void);
+unsigned int clocksource_freq(void);
+unsigned long long cycles_to_ns(unsigned long long cycles);
+unsigned long long ktime_get_ns(void);
+
+void tick_nohz_idle_enter(void);
+void tick_nohz_idle_exit(void);
+void cpu_idle(void);
+
+void udelay(unsigned int usecs);
+void mdelay(unsigned int msecs);
+
+/* ----------------- software timers ------------------------ */
+
+// Compare jiffies correctly even when they wrap
+#define time_after(a,b)		((long)((b)-(a)) < 0)
+#define time_before(a,b)	time_after(b,a)
+#define time_after_eq(a,b)	((long)((a)-(b)) >= 0)
+
+// A function run in interrupt context when "jiffies" reaches "expires"
+struct timer_list {
+	struct list_head entry;    // links timers in the same bucket of the wheel
+	unsigned long expires;
+	void (*function)(unsigned long data);
+	unsigned long data;
+};
+
+#define timer_pending(t)	((t)->entry.next != (void *)0)
+
+void init_timers(void);
+void init_timer(struct timer_list *timer);
+void add_timer(struct timer_list *timer);
+int del_timer(struct timer_list *timer);
+int mod_timer(struct timer_list *timer, unsigned long expires);
+void run_timers(void);
+unsigned long get_next_timer_interrupt(void);
+unsigned long schedule_timeout(unsigned long timeout);
+
+
+#endif // TIMER_H
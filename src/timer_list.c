@@ -0,0 +1,248 @@
+/* timer_list.c
+ * Kernel software timers organized as a hierarchical timing wheel
+ *
+ * NOTE
+ * 1. The wheel has 5 levels. Level 1 (tv1) has 256 buckets, one per jiffy
+ *    for the next 256 jiffies; each bucket of level n (n>1) covers 2^(8+6*(n-2))
+ *    jiffies, and the 5 levels together cover all 2^32 jiffies.
+ * 2. A timer is put into the bucket of its expiry at the lowest level that
+ *    covers it, so adding and deleting a timer is O(1) no matter how many
+ *    timers there are.
+ * 3. Each time tv1 goes around, the next bucket of tv2 is cascaded, i.e.,
+ *    its timers are re-added and spread over tv1, and so on upwards.
+*/
+
+#include "timer.h"
+#include "interrupt.h"
+#include "proc.h"
+#include "initcall.h"
+
+#define NULL ((void *)0)
+
+#define TVN_BITS	6
+#define TVR_BITS	8
+#define TVN_SIZE	(1 << TVN_BITS)
+#define TVR_SIZE	(1 << TVR_BITS)
+#define TVN_MASK	(TVN_SIZE - 1)
+#define TVR_MASK	(TVR_SIZE - 1)
+
+// Index of the bucket of level n+2 that "jiffies" falls into
+#define INDEX(n)	((timer_jiffies >> (TVR_BITS + (n) * TVN_BITS)) & TVN_MASK)
+
+static struct list_head tv1[TVR_SIZE];
+static struct list_head tv2[TVN_SIZE];
+static struct list_head tv3[TVN_SIZE];
+static struct list_head tv4[TVN_SIZE];
+static struct list_head tv5[TVN_SIZE];
+
+// The next jiffy whose timers are to be run
+static unsigned long timer_jiffies;
+
+/* Initialize the timing wheel; called by timer_init() before the tick starts */
+void __init init_timers(void)
+{
+	int i;
+
+	for(i=0; i<TVR_SIZE; i++) {
+		INIT_LIST_HEAD(&tv1[i]);
+	}
+
+	for(i=0; i<TVN_SIZE; i++) {
+		INIT_LIST_HEAD(&tv2[i]);
+		INIT_LIST_HEAD(&tv3[i]);
+		INIT_LIST_HEAD(&tv4[i]);
+		INIT_LIST_HEAD(&tv5[i]);
+	}
+
+	timer_jiffies = jiffies;
+}
+
+/* Put "timer" into the bucket its expiry falls into */
+static void internal_add_timer(struct timer_list *timer)
+{
+	unsigned long expires = timer->expires;
+	unsigned long idx = expires - timer_jiffies;
+	struct list_head *vec;
+
+	if(idx < TVR_SIZE) {
+		vec = tv1 + (expires & TVR_MASK);
+	} else if(idx < 1 << (TVR_BITS + TVN_BITS)) {
+		vec = tv2 + ((expires >> TVR_BITS) & TVN_MASK);
+	} else if(idx < 1 << (TVR_BITS + 2 * TVN_BITS)) {
+		vec = tv3 + ((expires >> (TVR_BITS + TVN_BITS)) & TVN_MASK);
+	} else if(idx < 1 << (TVR_BITS + 3 * TVN_BITS)) {
+		vec = tv4 + ((expires >> (TVR_BITS + 2 * TVN_BITS)) & TVN_MASK);
+	} else if((long)idx < 0) {
+		// Already expired; run it at the next jiffy
+		vec = tv1 + (timer_jiffies & TVR_MASK);
+	} else {
+		vec = tv5 + ((expires >> (TVR_BITS + 3 * TVN_BITS)) & TVN_MASK);
+	}
+
+	list_add_tail(&timer->entry, vec);
+}
+
+static void detach_timer(struct timer_list *timer)
+{
+	list_del(&timer->entry);
+	timer->entry.next = NULL;
+}
+
+/* Initialize a timer before it is used */
+void init_timer(struct timer_list *timer)
+{
+	timer->entry.next = NULL;
+	timer->entry.prev = NULL;
+}
+
+/* Start "timer"; "expires", "function" and "data" must have been set */
+void add_timer(struct timer_list *timer)
+{
+	unsigned int flags;
+
+	flags = local_irq_save();
+	if(timer_pending(timer)) {
+		detach_timer(timer);
+	}
+	internal_add_timer(timer);
+	local_irq_restore(flags);
+}
+
+/* Stop "timer"; return 1 if it was pending, otherwise 0 */
+int del_timer(struct timer_list *timer)
+{
+	unsigned int flags;
+	int ret = 0;
+
+	flags = local_irq_save();
+	if(timer_pending(timer)) {
+		detach_timer(timer);
+		ret = 1;
+	}
+	local_irq_restore(flags);
+
+	return ret;
+}
+
+/* (Re)start "timer" to expire at "expires"; return 1 if it was pending */
+int mod_timer(struct timer_list *timer, unsigned long expires)
+{
+	unsigned int flags;
+	int ret = 0;
+
+	flags = local_irq_save();
+	if(timer_pending(timer)) {
+		detach_timer(timer);
+		ret = 1;
+	}
+	timer->expires = expires;
+	internal_add_timer(timer);
+	local_irq_restore(flags);
+
+	return ret;
+}
+
+/* Re-add the timers of bucket "index" of "tv" to lower levels
+ *
+ * Return value: "index"; when it is 0, the level above has to be cascaded too
+ */
+static int cascade(struct list_head *tv, int index)
+{
+	struct list_head list, *pos, *n;
+
+	list_replace_init(tv + index, &list);
+
+	list_for_each_safe(pos, n, &list) {
+		internal_add_timer(list_entry(pos, struct timer_list, entry));
+	}
+
+	return index;
+}
+
+/* Run all the timers that have expired by now
+ *
+ * NOTE
+ * It is called from the tick handler, i.e., with interrupts disabled.
+ * Timer functions can add, modify or delete timers, including themselves.
+ */
+void run_timers(void)
+{
+	struct list_head work_list, *head = &work_list;
+	struct timer_list *timer;
+	int index;
+
+	while(time_after_eq(jiffies, timer_jiffies)) {
+		index = timer_jiffies & TVR_MASK;
+
+		if(!index &&
+			(!cascade(tv2, INDEX(0))) &&
+				(!cascade(tv3, INDEX(1))) &&
+					!cascade(tv4, INDEX(2))) {
+			cascade(tv5, INDEX(3));
+		}
+		timer_jiffies++;
+
+		list_replace_init(tv1 + index, head);
+		while(!list_empty(head)) {
+			timer = list_entry(head->next, struct timer_list, entry);
+			detach_timer(timer);
+			timer->function(timer->data);
+		}
+	}
+}
+
+/* Get the jiffy before which no timer needs to be run
+ *
+ * NOTE
+ * Only tv1 is searched. When it is empty up to the next cascade, the
+ * jiffy of the cascade is returned, which may be earlier than the next
+ * timer but is never later. It should be called with interrupts disabled.
+ */
+unsigned long get_next_timer_interrupt(void)
+{
+	unsigned long expires;
+	int index;
+
+	expires = timer_jiffies;
+	index = expires & TVR_MASK;
+	do {
+		if(!list_empty(&tv1[index])) {
+			return expires;
+		}
+		expires++;
+		index = (index + 1) & TVR_MASK;
+	} while(index);
+
+	return expires;
+}
+
+/* Wake up the process sleeping in schedule_timeout() */
+static void process_timeout(unsigned long data)
+{
+	wake_up_process((struct task_info *)data);
+}
+
+/* Sleep for "timeout" jiffies, unless woken up earlier by wake_up_process()
+ *
+ * Return value: the # of jiffies left, 0 if it timed out
+ */
+unsigned long schedule_timeout(unsigned long timeout)
+{
+	struct timer_list timer;
+	unsigned long expire = jiffies + timeout;
+
+	init_timer(&timer);
+	timer.expires = expire;
+	timer.function = process_timeout;
+	timer.data = (unsigned long)current;
+
+	current->state = TASK_SLEEPING;
+	add_timer(&timer);
+	// The scheduler keeps running a sleeping process if no other is runnable
+	while(current->state == TASK_SLEEPING) {
+		schedule();
+	}
+	del_timer(&timer);
+
+	return time_after(expire, jiffies) ? expire - jiffies : 0;
+}
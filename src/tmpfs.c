@@ -0,0 +1,318 @@
+/* tmpfs.c
+ * A writable file system in memory
+ *
+ * NOTE
+ * 1. File data is kept in pages from the buddy allocator. Each file has a
+ *    page table, itself a page, that maps page indexes of the file to data
+ *    pages; pages are allocated on the first write, and holes read as 0. So
+ *    reading or writing is a table lookup plus a memcpy to/from the caller,
+ *    with no device and no intermediate buffer involved.
+ * 2. The namespace is flat: a file name is the whole path, and files are
+ *    found by a hash of it.
+ * 3. Updates of the hash table and of the page tables are done with 
+ *    interrupts disabled; the data of a file is not protected against 
+ *    concurrent writers.
+ * 4. namei() and create() return the inode with one more user, which is
+ *    dropped by iput(), e.g., when the open file is released. Unlinking a
+ *    file only takes it off the hash table; its memory is freed when the
+ *    last user is gone, so open files stay readable and writable.
+*/
+
+#include "fs.h"
+#include "string.h"
+#include "memory.h"
+#include "interrupt.h"
+#include "util_list.h"
+#include "initcall.h"
+
+#define NULL ((void *)0)
+
+#define TMPFS_HASH_SIZE			32		// a power of 2
+// # of entries of a file's page table, which limits the file size
+#define TMPFS_PTRS_PER_PAGE		(PAGE_SIZE/sizeof(void *))
+#define TMPFS_MAX_FILE_SIZE		(TMPFS_PTRS_PER_PAGE*PAGE_SIZE)
+
+struct tmpfs_inode {
+	struct inode vfs;
+	struct list_head hash;
+	void **pages;               // page table; NULL for an empty file
+	unsigned int nr_pages;      // # of data pages allocated
+	int unlinked;               // off the hash table, see NOTE 4
+};
+
+#define TMPFS_I(node)	container_of(node, struct tmpfs_inode, vfs)
+
+static struct list_head tmpfs_hash[TMPFS_HASH_SIZE];
+
+struct super_block tmpfs_super_block;
+
+static unsigned int tmpfs_hashfn(const char *name)
+{
+	unsigned int h = 0;
+
+	while(*name) {
+		h = h*31 + *name++;
+	}
+
+	return h & (TMPFS_HASH_SIZE-1);
+}
+
+static struct tmpfs_inode *tmpfs_lookup(const char *name)
+{
+	struct list_head *pos;
+	struct tmpfs_inode *ti;
+
+	list_for_each(pos, &tmpfs_hash[tmpfs_hashfn(name)]) {
+		ti = list_entry(pos, struct tmpfs_inode, hash);
+		if(!strcmp(ti->vfs.name, name)) {
+			return ti;
+		}
+	}
+
+	return NULL;
+}
+
+/* Given the name of a file, get its inode */
+struct inode *tmpfs_namei(struct super_block *super, char *name)
+{
+	struct tmpfs_inode *ti;
+	unsigned int flags;
+
+	flags = local_irq_save();
+	if((ti = tmpfs_lookup(name))) {
+		ti->vfs.count++;
+	}
+	local_irq_restore(flags);
+
+	return ti ? &ti->vfs : NULL;
+}
+
+/* Create an empty file, or get the file if it exists */
+struct inode *tmpfs_create(struct super_block *super, char *name)
+{
+	struct tmpfs_inode *ti, *old;
+	unsigned int flags;
+
+	if((ti = (struct tmpfs_inode *)kmalloc(sizeof(struct tmpfs_inode))) == NULL) {
+		return NULL;
+	}
+	if((ti->vfs.name = (char *)kmalloc(strlen(name)+1)) == NULL) {
+		kfree(ti);
+		return NULL;
+	}
+	strcpy(ti->vfs.name, name);
+	ti->vfs.flags = 0;
+	ti->vfs.dsize = 0;
+	ti->vfs.daddr = 0;
+	ti->vfs.super = super;
+	// Kept by tmpfs itself, not in the inode cache
+	ti->vfs.ino = (unsigned int)ti;
+	ti->vfs.count = 1;
+	ti->vfs.state = 0;
+	ti->pages = NULL;
+	ti->nr_pages = 0;
+	ti->unlinked = 0;
+
+	flags = local_irq_save();
+	if((old = tmpfs_lookup(name))) {
+		old->vfs.count++;
+		local_irq_restore(flags);
+		kfree(ti->vfs.name);
+		kfree(ti);
+		return &old->vfs;
+	}
+	list_add(&ti->hash, &tmpfs_hash[tmpfs_hashfn(name)]);
+	local_irq_restore(flags);
+
+	return &ti->vfs;
+}
+
+/* Free a file that has been unlinked and has no users */
+static void tmpfs_free(struct tmpfs_inode *ti)
+{
+	unsigned int i;
+
+	if(ti->pages) {
+		for(i=0; i<TMPFS_PTRS_PER_PAGE; i++) {
+			if(ti->pages[i]) {
+				put_free_pages(ti->pages[i], 0);
+			}
+		}
+		put_free_pages(ti->pages, 0);
+	}
+	kfree(ti->vfs.name);
+	kfree(ti);
+}
+
+/* Drop a user of a file; called by iput() */
+void tmpfs_put_inode(struct inode *node)
+{
+	struct tmpfs_inode *ti = TMPFS_I(node);
+	unsigned int flags;
+	int dead;
+
+	flags = local_irq_save();
+	dead = --ti->vfs.count == 0 && ti->unlinked;
+	local_irq_restore(flags);
+
+	if(dead) {
+		tmpfs_free(ti);
+	}
+}
+
+/* Remove a file; it is freed once it has no users, see NOTE 4 */
+int tmpfs_unlink(struct super_block *super, char *name)
+{
+	struct tmpfs_inode *ti;
+	unsigned int flags;
+	int dead;
+
+	flags = local_irq_save();
+	if((ti = tmpfs_lookup(name)) == NULL) {
+		local_irq_restore(flags);
+		return -1;
+	}
+	list_del(&ti->hash);
+	ti->unlinked = 1;
+	dead = ti->vfs.count == 0;
+	local_irq_restore(flags);
+
+	if(dead) {
+		tmpfs_free(ti);
+	}
+
+	return 0;
+}
+
+/* Get the page holding page "index" of a file
+ *
+ * Return value: addr of the page, or NULL if it is a hole and "create" is 0,
+ *  or if no memory is left
+ */
+void *tmpfs_get_page(struct inode *node, unsigned int index, int create)
+{
+	struct tmpfs_inode *ti = TMPFS_I(node);
+	void *page = NULL;
+	unsigned int flags;
+
+	if(index >= TMPFS_PTRS_PER_PAGE) {
+		return NULL;
+	}
+
+	/// Two writers must not both allocate the same page
+	flags = local_irq_save();
+	if(ti->pages == NULL) {
+		if(!create || (ti->pages = (void **)get_free_pages(0, 0)) == NULL) {
+			goto OUT;
+		}
+		memset(ti->pages, 0, PAGE_SIZE);
+	}
+
+	if((page = ti->pages[index]) == NULL && create) {
+		if((page = get_free_pages(0, 0)) == NULL) {
+			goto OUT;
+		}
+		memset(page, 0, PAGE_SIZE);
+		ti->pages[index] = page;
+		ti->nr_pages++;
+	}
+OUT:
+	local_irq_restore(flags);
+
+	return page;
+}
+
+/* Read "size" bytes at offset "pos" of a file
+ *
+ * Return value: # of bytes read, which is less than "size" at the end of file
+ */
+int tmpfs_read(struct inode *node, void *buf, unsigned int pos, size_t size)
+{
+	unsigned int n, offset, done = 0;
+	char *page, *p = (char *)buf;
+
+	if(pos >= node->dsize) {
+		return 0;
+	}
+	if(size > node->dsize - pos) {
+		size = node->dsize - pos;
+	}
+
+	while(done < size) {
+		offset = pos & ~PAGE_MASK;
+		n = PAGE_SIZE - offset;
+		if(n > size - done) { n = size - done; }
+
+		if((page = (char *)tmpfs_get_page(node, pos >> PAGE_SHIFT, 0))) {
+			memcpy(p, page + offset, n);
+		} else {
+			memset(p, 0, n);
+		}
+
+		p += n;
+		pos += n;
+		done += n;
+	}
+
+	return done;
+}
+
+/* Write "size" bytes at offset "pos" of a file, extending it if needed
+ *
+ * Return value: # of bytes written, which is less than "size" when the file
+ *  reaches its max size or memory runs out; -1 if nothing is written
+ */
+int tmpfs_write(struct inode *node, const void *buf, unsigned int pos, size_t size)
+{
+	unsigned int n, offset, done = 0;
+	const char *p = (const char *)buf;
+	char *page;
+
+	while(done < size) {
+		if(pos >= TMPFS_MAX_FILE_SIZE) {
+			break;
+		}
+		if((page = (char *)tmpfs_get_page(node, pos >> PAGE_SHIFT, 1)) == NULL) {
+			break;
+		}
+
+		offset = pos & ~PAGE_MASK;
+		n = PAGE_SIZE - offset;
+		if(n > size - done) { n = size - done; }
+		memcpy(page + offset, p, n);
+
+		p += n;
+		pos += n;
+		done += n;
+		if(pos > node->dsize) {
+			node->dsize = pos;
+		}
+	}
+
+	return (done == 0 && size != 0) ? -1 : done;
+}
+
+// struct "super_block" for tmpfs file system
+struct super_block tmpfs_super_block = {
+	.namei = tmpfs_namei,
+	.create = tmpfs_create,
+	.unlink = tmpfs_unlink,
+	.read = tmpfs_read,
+	.write = tmpfs_write,
+	.get_page = tmpfs_get_page,
+	.put_inode = tmpfs_put_inode,
+	.name = "tmpfs",
+};
+
+/* Initialize tmpfs file system */
+int __init tmpfs_init(void)
+{
+	int i;
+
+	for(i=0; i<TMPFS_HASH_SIZE; i++) {
+		INIT_LIST_HEAD(&tmpfs_hash[i]);
+	}
+
+	return register_file_system(&tmpfs_super_block, TMPFS);
+}
+fs_initcall(tmpfs_init);
@@ -0,0 +1,131 @@
+/* trace.c
+ * Binary event tracing: trace_printk() records events in a ring buffer
+ *
+ * NOTE
+ * 1. An event is a fixed-size record: the format string pointer, the 
+ *    clocksource cycles since boot, the process and the raw argument words, 
+ *    so recording one costs a few tens of cycles instead of a printk().
+ * 2. Events are stored in a fixed ring buffer for the whole boot; when it is 
+ *    full, the oldest events are overwritten.
+ * 3. The buffer is dumped over the UART in the following format, and
+ *    tools/trace_decode.py formats the events with kernel.elf:
+ *        TRACE BEGIN events=<n> lost=<n> freq=<clocksource Hz>
+ *        T <cycles hi> <cycles lo> <task> <fmt> <arg0> <arg1> <arg2> <arg3>
+ *        ...
+ *        TRACE END
+ * 4. Tracing needs the clocksource, so it cannot be started before 
+ *    timer_init().
+*/
+
+#include "trace.h"
+#include "interrupt.h"
+#include "timer.h"
+#include "proc.h"
+#include "uart.h"
+#include "print.h"
+
+#define TRACE_BUF_SIZE	1024	// # of events; must be a power of 2
+
+struct trace_event {
+	const char *fmt;
+	unsigned int ts_lo;     // clocksource cycles since boot
+	unsigned int ts_hi;
+	unsigned int task;      // addr of "struct task_info" of the process
+	unsigned int args[TRACE_MAX_ARGS];
+};
+
+static struct trace_event trace_buf[TRACE_BUF_SIZE];
+static unsigned int trace_head;	// # of events recorded since the last reset
+int trace_on;
+
+/* Record an event; called by trace_printk() */
+void __trace_printk(const char *fmt, unsigned int a0, unsigned int a1,
+			unsigned int a2, unsigned int a3)
+{
+	struct trace_event *e;
+	unsigned long long ts;
+	unsigned int flags;
+
+	flags = local_irq_save();
+	ts = clocksource_cycles();
+	e = &trace_buf[trace_head++ & (TRACE_BUF_SIZE-1)];
+	e->fmt = fmt;
+	e->ts_lo = (unsigned int)ts;
+	e->ts_hi = (unsigned int)(ts >> 32);
+	// Interrupt handlers run on the stack of the interrupted process
+	e->task = (unsigned int)current_task_info();
+	e->args[0] = a0;
+	e->args[1] = a1;
+	e->args[2] = a2;
+	e->args[3] = a3;
+	local_irq_restore(flags);
+}
+
+/* Discard all events and start tracing */
+void trace_start(void)
+{
+	unsigned int flags;
+
+	flags = local_irq_save();
+	trace_head = 0;
+	trace_on = 1;
+	local_irq_restore(flags);
+}
+
+void trace_stop(void)
+{
+	trace_on = 0;
+}
+
+/* Print all events over the UART; tracing is stopped while dumping */
+void trace_dump(void)
+{
+	unsigned int i, n, start, lost;
+	int on = trace_on, polled;
+	struct trace_event *e;
+
+	trace_on = 0;
+	// The dump is far larger than the TX ring, and may run with interrupts 
+	// disabled, so nothing may be dropped or left queued
+	polled = uart_set_polled(1);
+
+	n = trace_head;
+	lost = 0;
+	if(n > TRACE_BUF_SIZE) {
+		lost = n - TRACE_BUF_SIZE;
+		n = TRACE_BUF_SIZE;
+	}
+	start = trace_head - n;
+
+	printk("TRACE BEGIN events=%u lost=%u freq=%u\n", n, lost, clocksource_freq());
+	for(i=0; i<n; i++) {
+		e = &trace_buf[(start+i) & (TRACE_BUF_SIZE-1)];
+		printk("T %x %x %x %x %x %x %x %x\n", e->ts_hi, e->ts_lo, e->task,
+			(unsigned int)e->fmt, e->args[0], e->args[1], e->args[2], e->args[3]);
+	}
+	printk("TRACE END\n");
+
+	uart_set_polled(polled);
+	trace_on = on;
+}
+
+#ifdef CONFIG_TRACE
+static struct timer_list trace_timer;
+
+static void trace_timer_fn(unsigned long data)
+{
+	trace_stop();
+	trace_dump();
+}
+
+/* Trace the system from boot for CONFIG_TRACE seconds, then dump */
+void trace_boot_init(void)
+{
+	init_timer(&trace_timer);
+	trace_timer.expires = jiffies + CONFIG_TRACE*HZ;
+	trace_timer.function = trace_timer_fn;
+	add_timer(&trace_timer);
+
+	trace_start();
+}
+#endif
@@ -0,0 +1,43 @@
+/* trace.h
+ * Binary event tracing, see trace.c
+ *
+ * NOTE
+ * trace_printk() takes a format string literal and up to TRACE_MAX_ARGS
+ * int-sized arguments, but formats nothing: it records the pointer to the 
+ * format, a timestamp and the raw argument words. Formatting is done on the 
+ * host by tools/trace_decode.py, which reads the format strings from 
+ * kernel.elf. Since only the pointer is kept, "%s" arguments are decoded 
+ * only if they point to strings in kernel.elf.
+*/
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#define TRACE_MAX_ARGS	4
+
+// Tracing is on when it is not 0
+extern int trace_on;
+
+void __trace_printk(const char *fmt, unsigned int a0, unsigned int a1,
+			unsigned int a2, unsigned int a3);
+
+/// Pick the first TRACE_MAX_ARGS args, padding with 0s; "x" eats the comma
+#define __TRACE_ARGS(x, a0, a1, a2, a3, ...) \
+	(unsigned int)(a0), (unsigned int)(a1), (unsigned int)(a2), (unsigned int)(a3)
+
+/* Record an event if tracing is on; e.g., trace_printk("irq %d", irq) */
+#define trace_printk(fmt, ...) do { \
+		if(trace_on) { \
+			__trace_printk(fmt, __TRACE_ARGS(0, ##__VA_ARGS__, 0, 0, 0, 0)); \
+		} \
+	} while(0)
+
+void trace_start(void);
+void trace_stop(void);
+void trace_dump(void);
+#ifdef CONFIG_TRACE
+void trace_boot_init(void);
+#endif
+
+
+#endif // TRACE_H
@@ -0,0 +1,259 @@
+/* uart.c
+ * Driver of s3c2410's UART0, see uart.h
+*/
+
+#include "uart.h"
+#include "interrupt.h"
+#include "initcall.h"
+
+#define UART0_BASE	(0xd0000000)
+#define ULCON0		((volatile unsigned int *)(UART0_BASE+0x00))
+#define UCON0		((volatile unsigned int *)(UART0_BASE+0x04))
+#define UFCON0		((volatile unsigned int *)(UART0_BASE+0x08))
+#define UMCON0		((volatile unsigned int *)(UART0_BASE+0x0c))
+#define UERSTAT0	((volatile unsigned int *)(UART0_BASE+0x14))
+#define UFSTAT0		((volatile unsigned int *)(UART0_BASE+0x18))
+#define UTXH0		((volatile unsigned char *)(UART0_BASE+0x20))
+#define URXH0		((volatile unsigned char *)(UART0_BASE+0x24))
+#define UBRDIV0		((volatile unsigned int *)(UART0_BASE+0x28))
+
+#define UART_PCLK			50000000
+#define UART_BAUD			115200
+
+#define ULCON_8N1			0x3
+/// UCON: RX and TX in interrupt mode, RX error and timeout interrupts, 
+/// level-triggered interrupts
+#define UCON_RX_INT			(0x1<<0)
+#define UCON_TX_INT			(0x1<<2)
+#define UCON_RX_ERR_INT		(0x1<<6)
+#define UCON_RX_TIMEOUT		(0x1<<7)
+#define UCON_RX_LEVEL		(0x1<<8)
+#define UCON_TX_LEVEL		(0x1<<9)
+/// UFCON: FIFOs on; RX interrupt at 8 bytes, TX interrupt at 4 bytes or less
+#define UFCON_FIFO_EN		(0x1<<0)
+#define UFCON_RX_RESET		(0x1<<1)
+#define UFCON_TX_RESET		(0x1<<2)
+#define UFCON_RX_TRIG_8		(0x1<<4)
+#define UFCON_TX_TRIG_4		(0x1<<6)
+/// UFSTAT
+#define UFSTAT_RX_COUNT		(0xf)
+#define UFSTAT_RX_FULL		(0x1<<8)
+#define UFSTAT_TX_FULL		(0x1<<9)
+
+#define UART_SUBIRQS	((1<<SUBIRQ_RXD0)|(1<<SUBIRQ_TXD0)|(1<<SUBIRQ_ERR0))
+
+/// Rings; indices run freely and wrap at 2^32
+static char tx_ring[UART_TX_RING_SIZE];
+static unsigned int tx_head, tx_tail;
+static char rx_ring[UART_RX_RING_SIZE];
+static unsigned int rx_head, rx_tail;
+
+static int uart_ready;
+static int uart_polled;
+static int tx_irq_on;
+static int overflow_policy = UART_OVERFLOW_DROP_NEW;
+static struct uart_stats ustats;
+
+/* Write one char to the FIFO, waiting until it has room */
+static void uart_putc_polled(char c)
+{
+	while(*UFSTAT0 & UFSTAT_TX_FULL);
+	*UTXH0 = c;
+}
+
+/* Move chars from the TX ring into the FIFO until either is exhausted;
+ * called with interrupts disabled
+ */
+static void uart_tx_fill(void)
+{
+	while(tx_head != tx_tail && !(*UFSTAT0 & UFSTAT_TX_FULL)) {
+		*UTXH0 = tx_ring[tx_head++ & (UART_TX_RING_SIZE-1)];
+		ustats.tx_bytes++;
+	}
+}
+
+/* Start transmitting the TX ring; called with interrupts disabled */
+static void uart_tx_start(void)
+{
+	uart_tx_fill();
+
+	if(tx_head != tx_tail && !tx_irq_on) {
+		tx_irq_on = 1;
+		umask_subint(SUBIRQ_TXD0);
+	}
+}
+
+/* Move chars from the RX FIFO into the RX ring */
+static void uart_rx_drain(void)
+{
+	char c;
+
+	while(*UFSTAT0 & (UFSTAT_RX_COUNT|UFSTAT_RX_FULL)) {
+		c = *URXH0;
+		ustats.rx_bytes++;
+
+		if(rx_tail - rx_head >= UART_RX_RING_SIZE) {
+			ustats.rx_dropped++;
+			continue;
+		}
+		rx_ring[rx_tail++ & (UART_RX_RING_SIZE-1)] = c;
+	}
+}
+
+static void uart_interrupt(unsigned int irq)
+{
+	unsigned int pending = ack_subint(irq, UART_SUBIRQS);
+
+	if(pending & (1<<SUBIRQ_ERR0)) {
+		// Reading clears the error
+		if(*UERSTAT0) { ustats.rx_errors++; }
+	}
+
+	if(pending & ((1<<SUBIRQ_RXD0)|(1<<SUBIRQ_ERR0))) {
+		uart_rx_drain();
+	}
+
+	if(pending & (1<<SUBIRQ_TXD0)) {
+		uart_tx_fill();
+		if(tx_head == tx_tail) {
+			tx_irq_on = 0;
+			mask_subint(SUBIRQ_TXD0);
+		}
+	}
+}
+
+/* Queue "count" chars for transmission
+ *
+ * Return value: # of chars queued, which is less than "count" if some are
+ *  dropped by the overflow policy
+ */
+int uart_write(const char *buf, unsigned int count)
+{
+	unsigned int flags, i;
+
+	if(!uart_ready || uart_polled) {
+		for(i=0; i<count; i++) {
+			uart_putc_polled(buf[i]);
+		}
+		return count;
+	}
+
+	flags = local_irq_save();
+	for(i=0; i<count; i++) {
+		if(tx_tail - tx_head >= UART_TX_RING_SIZE) {
+			if(overflow_policy == UART_OVERFLOW_DROP_NEW) {
+				ustats.tx_dropped += count - i;
+				break;
+			} else if(overflow_policy == UART_OVERFLOW_DROP_OLD) {
+				tx_head++;
+				ustats.tx_dropped++;
+			} else {
+				while(tx_tail - tx_head >= UART_TX_RING_SIZE) {
+					uart_tx_fill();
+				}
+			}
+		}
+		tx_ring[tx_tail++ & (UART_TX_RING_SIZE-1)] = buf[i];
+	}
+	uart_tx_start();
+	local_irq_restore(flags);
+
+	return i;
+}
+
+/* Get a received char, or -1 if there is none */
+int uart_getc(void)
+{
+	unsigned int flags;
+	int c = -1;
+
+	flags = local_irq_save();
+	if(rx_head != rx_tail) {
+		c = (unsigned char)rx_ring[rx_head++ & (UART_RX_RING_SIZE-1)];
+	}
+	local_irq_restore(flags);
+
+	return c;
+}
+
+/* Get up to "count" received chars without waiting
+ *
+ * Return value: # of chars got
+ */
+int uart_read(char *buf, unsigned int count)
+{
+	unsigned int i;
+	int c;
+
+	for(i=0; i<count && (c = uart_getc()) >= 0; i++) {
+		buf[i] = c;
+	}
+
+	return i;
+}
+
+/* Wait until the TX ring has been written into the FIFO */
+void uart_flush(void)
+{
+	unsigned int flags;
+
+	flags = local_irq_save();
+	while(tx_head != tx_tail) {
+		uart_tx_fill();
+	}
+	local_irq_restore(flags);
+}
+
+void uart_set_overflow_policy(int policy)
+{
+	overflow_policy = policy;
+}
+
+/* Write chars to the FIFO directly if "polled" is not 0, e.g., on a panic,
+ * when interrupts may never be handled again
+ *
+ * Return value: the previous setting
+ */
+int uart_set_polled(int polled)
+{
+	int old = uart_polled;
+
+	if(polled) {
+		uart_flush();
+	}
+	uart_polled = polled;
+
+	return old;
+}
+
+void uart_get_stats(struct uart_stats *stats)
+{
+	*stats = ustats;
+}
+
+/* Initialize UART0 and switch output to the TX ring
+ *
+ * NOTE
+ * Chars written before are still in the FIFO, so it is not reset.
+ */
+int __init uart_init(void)
+{
+	*ULCON0 = ULCON_8N1;
+	*UCON0 = UCON_RX_INT | UCON_TX_INT | UCON_RX_ERR_INT | UCON_RX_TIMEOUT 
+		| UCON_RX_LEVEL | UCON_TX_LEVEL;
+	*UFCON0 = UFCON_FIFO_EN | UFCON_RX_RESET | UFCON_RX_TRIG_8 | UFCON_TX_TRIG_4;
+	*UMCON0 = 0;
+	*UBRDIV0 = UART_PCLK/(UART_BAUD*16) - 1;
+
+	mask_subint(SUBIRQ_TXD0);
+	umask_subint(SUBIRQ_RXD0);
+	umask_subint(SUBIRQ_ERR0);
+	ack_subint(IRQ_UART0, UART_SUBIRQS);
+
+	if(request_irq(IRQ_UART0, uart_interrupt)) {
+		return -1;
+	}
+	uart_ready = 1;
+
+	return 0;
+}
@@ -0,0 +1,48 @@
+/* uart.h
+ * Interrupt-driven driver of s3c2410's UART0
+ *
+ * NOTE
+ * 1. Output is put into a TX ring and the caller returns at once; the ring
+ *    is drained into the 16-byte TX FIFO by the TX interrupt, which is only
+ *    unmasked while the ring has data. Input is moved from the RX FIFO into
+ *    an RX ring by the RX interrupt.
+ * 2. When the TX ring is full, the overflow policy decides what happens:
+ *    the new characters are dropped (default), the oldest queued ones are
+ *    dropped, or the caller polls the FIFO until there is room. Characters
+ *    received while the RX ring is full are dropped. Drops are counted.
+ * 3. Before uart_init(), and after uart_set_polled(1), characters are
+ *    written to the FIFO directly, which is what a panic should use.
+*/
+
+#ifndef UART_H
+#define UART_H
+
+
+#define UART_TX_RING_SIZE	4096	// a power of 2
+#define UART_RX_RING_SIZE	256		// a power of 2
+
+/// Overflow policies of the TX ring
+#define UART_OVERFLOW_DROP_NEW	0
+#define UART_OVERFLOW_DROP_OLD	1
+#define UART_OVERFLOW_POLL		2
+
+struct uart_stats {
+	unsigned int tx_bytes;      // bytes written into the FIFO
+	unsigned int rx_bytes;      // bytes read from the FIFO
+	unsigned int tx_dropped;
+	unsigned int rx_dropped;
+	unsigned int rx_errors;
+};
+
+
+int uart_init(void);
+void uart_set_overflow_policy(int policy);
+int uart_set_polled(int polled);
+int uart_write(const char *buf, unsigned int count);
+int uart_getc(void);
+int uart_read(char *buf, unsigned int count);
+void uart_flush(void);
+void uart_get_stats(struct uart_stats *stats);
+
+
+#endif // UART_H
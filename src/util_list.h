@@ -47,6 +47,27 @@ static inline void list_del(struct list_head *entry)
     __list_del(entry->prev, entry->next);
 }
 
+static inline void list_del_init(struct list_head *entry)
+{
+    __list_del(entry->prev, entry->next);
+    INIT_LIST_HEAD(entry);
+}
+
+// Move all the entries of list "old" to list "new_lst", leaving "old" empty
+static inline void
+list_replace_init(struct list_head *old, struct list_head *new_lst)
+{
+    if (old->next == old) {
+	INIT_LIST_HEAD(new_lst);
+	return;
+    }
+    new_lst->next = old->next;
+    new_lst->next->prev = new_lst;
+    new_lst->prev = old->prev;
+    new_lst->prev->next = new_lst;
+    INIT_LIST_HEAD(old);
+}
+
 static inline void
 list_remove_chain(struct list_head *ch, struct list_head *ct)
 {
@@ -102,5 +123,10 @@ static inline int list_empty(const struct list_head *head)
 #define list_for_each(pos, head) \
 	for (pos = (head)->next; pos != (head); pos = pos->next)
 
+// Travese the list; "pos" can be removed from the list in the loop
+#define list_for_each_safe(pos, n, head) \
+	for (pos = (head)->next, n = pos->next; pos != (head); \
+		pos = n, n = pos->next)
+
 
 #endif // _UTIL_LIST_H_
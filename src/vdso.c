@@ -0,0 +1,81 @@
+/* vdso.c
+ * Kernel side of the vDSO page, see vdso.h
+*/
+
+#include "vdso.h"
+#include "mmu.h"
+#include "memory.h"
+#include "timer.h"
+#include "initcall.h"
+#include "print.h"
+
+// The vDSO page; the kernel writes it through this addr
+static union {
+	struct vdso_data data;
+	unsigned char page[PAGE_SIZE];
+} vdso_page __attribute__((aligned(PAGE_SIZE)));
+
+static struct vdso_data *vdata = &vdso_page.data;
+
+static inline void vdso_write_begin(void)
+{
+	vdata->seq++;
+	vdso_barrier();
+}
+
+static inline void vdso_write_end(void)
+{
+	vdso_barrier();
+	vdata->seq++;
+}
+
+/* Map the vDSO page for processes */
+void __init vdso_init(void)
+{
+	vdata->hz = HZ;
+
+	if(map_page(VDSO_ADDR, (unsigned int)vdata, PTE_AP_USER_RO)) {
+		printk("vDSO: cannot map the page\n");
+	}
+}
+
+/* Make the counter of clocksource "cs" readable by processes
+ *
+ * @Parameters: "paddr" is the physical addr of the counter register
+ */
+void vdso_set_clocksource(struct clocksource *cs, unsigned int paddr, int countdown)
+{
+	if(map_page(VDSO_COUNTER_PAGE, paddr & PAGE_MASK, PTE_AP_USER_RO)) {
+		printk("vDSO: cannot map the counter of %s\n", cs->name);
+		return;
+	}
+
+	vdso_write_begin();
+	vdata->cs_counter = VDSO_COUNTER_PAGE + (paddr & ~PAGE_MASK);
+	vdata->cs_countdown = countdown;
+	vdata->cs_mask = cs->mask;
+	vdata->cs_mult = cs->mult;
+	vdata->cs_shift = cs->shift;
+	vdso_write_end();
+}
+
+/* Take a snapshot of the clocksource; called by the tick
+ *
+ * @Parameters: "last" is the counter value read at "ns" ns since boot
+ */
+void update_vsyscall(unsigned int last, unsigned long long ns)
+{
+	vdso_write_begin();
+	vdata->cs_last = last;
+	vdata->ns_base = ns;
+	vdata->jiffies = jiffies;
+	vdso_write_end();
+}
+
+/* Publish the ID of the process that is about to run */
+void vdso_set_task(unsigned int pid)
+{
+	vdso_write_begin();
+	vdata->pid = pid;
+	vdso_write_end();
+}
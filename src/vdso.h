@@ -0,0 +1,109 @@
+/* vdso.h
+ * The vDSO page: data kept up to date by the kernel that processes can read
+ * without a system call
+ *
+ * NOTE
+ * 1. The page is mapped read-only for processes at VDSO_ADDR, and the counter
+ *    register of the clocksource at VDSO_COUNTER_ADDR, so the time since boot
+ *    is got with a few loads: the last snapshot of the clocksource taken by
+ *    the tick plus the cycles elapsed since then.
+ * 2. The kernel updates the page under a sequence count: it is odd while an
+ *    update is in progress. Readers retry until they have read an even count
+ *    that has not changed meanwhile. The kernel runs on one CPU, so an update
+ *    can only interrupt a reader, never the other way around.
+ * 3. The snapshot is taken every tick, and at most every clockevent max_delta
+ *    in tickless idle, which is shorter than a wrap of the clocksource.
+*/
+
+#ifndef VDSO_H
+#define VDSO_H
+
+
+#define VDSO_ADDR			0xc0000000
+#define VDSO_COUNTER_PAGE	(VDSO_ADDR+0x1000)
+
+struct vdso_data {
+	volatile unsigned int seq;      // sequence count
+
+	/// Clocksource snapshot
+	unsigned int cs_counter;        // user addr of the counter register
+	unsigned int cs_countdown;      // the counter counts down if not 0
+	unsigned int cs_mask;
+	unsigned int cs_mult;           // ns = (cycles*mult)>>shift
+	unsigned int cs_shift;
+	unsigned int cs_last;           // counter value at the snapshot
+	unsigned long long ns_base;     // ns since boot at the snapshot
+
+	unsigned long jiffies;
+	unsigned int hz;
+
+	/// Fields of the running process
+	unsigned int pid;
+};
+
+#define vdso_barrier()	asm volatile ("":::"memory")
+
+
+/* ----------------- User-space helpers ------------------------ */
+
+#define __vdso	((const struct vdso_data *)VDSO_ADDR)
+
+static inline unsigned int vdso_read_begin(void)
+{
+	unsigned int seq;
+
+	while((seq = __vdso->seq) & 1);
+	vdso_barrier();
+
+	return seq;
+}
+
+static inline int vdso_read_retry(unsigned int seq)
+{
+	vdso_barrier();
+	return __vdso->seq != seq;
+}
+
+/* Get the time since boot in ns */
+static inline unsigned long long vdso_clock_gettime_ns(void)
+{
+	unsigned long long ns;
+	unsigned int seq, now, delta;
+
+	do {
+		seq = vdso_read_begin();
+		now = *(volatile unsigned int *)__vdso->cs_counter;
+		if(__vdso->cs_countdown) {
+			now = ~now;
+		}
+		delta = (now - __vdso->cs_last) & __vdso->cs_mask;
+		ns = __vdso->ns_base +
+			(((unsigned long long)delta * __vdso->cs_mult) >> __vdso->cs_shift);
+	} while(vdso_read_retry(seq));
+
+	return ns;
+}
+
+/* Get the # of ticks since boot */
+static inline unsigned long vdso_get_jiffies(void)
+{
+	return __vdso->jiffies;
+}
+
+/* Get the ID of the calling process */
+static inline unsigned int vdso_getpid(void)
+{
+	return __vdso->pid;
+}
+
+
+/* ----------------- Kernel ------------------------ */
+
+struct clocksource;
+void vdso_init(void);
+void vdso_set_clocksource(struct clocksource *cs, unsigned int paddr, int countdown);
+void update_vsyscall(unsigned int last, unsigned long long ns);
+void vdso_set_task(unsigned int pid);
+
+
+#endif // VDSO_H
@@ -0,0 +1,393 @@
+/* zromfs.c
+ * A compressed read-only file system
+ *
+ * NOTE
+ * 1. The image is built by tools/mkzromfs.py, see the layout there, and
+ *    sits at ZROMFS_OFFSET of the ramdisk, after the romfs image.
+ * 2. File data is cut into blocks that are compressed one by one in the LZ4
+ *    block format, so reading any part of a file only decompresses the
+ *    blocks holding it. A block that the builder could not make smaller is
+ *    stored as it is, i.e., its stored size is its decompressed size.
+ * 3. Decompressed blocks are kept in a small LRU cache, so reading a file
+ *    in small pieces decompresses each block once. Compressed data is read
+ *    through the buffer cache.
+ * 4. The file table is read into memory at mount time and is sorted by
+ *    path, so namei() is a binary search.
+*/
+
+#include "fs.h"
+#include "storage.h"
+#include "string.h"
+#include "memory.h"
+#include "bcache.h"
+#include "interrupt.h"
+#include "proc.h"
+#include "util_list.h"
+#include "initcall.h"
+#include "print.h"
+
+#define NULL ((void *)0)
+
+
+#define ZROMFS_OFFSET		(1024*1024)	// of the image in the ramdisk
+#define ZROMFS_MAGIC		"-zrom1fs"
+#define ZROMFS_MAX_PATH		56
+#define ZROMFS_CACHE_BLOCKS	4			// # of decompressed blocks cached
+
+// Super block of the image; all ints are little-endian
+struct zromfs_super_block {
+	char magic[8];
+	unsigned int block_size;
+	unsigned int nr_files;
+	unsigned int nr_blocks;
+	unsigned int files_off;     // offset of the file table
+	unsigned int blocks_off;    // offset of the block table
+	unsigned int size;          // of the whole image
+};
+
+// An entry of the file table
+struct zromfs_file {
+	unsigned int size;
+	unsigned int first_block;
+	char path[ZROMFS_MAX_PATH];
+};
+
+// A decompressed block
+struct zromfs_cblock {
+	struct list_head lru;       // the most recent at the tail
+	unsigned int blocknr;
+	int valid;
+	char *data;
+};
+
+struct super_block zromfs_super_block;
+
+static struct zromfs_super_block zsb;
+static struct zromfs_file *zfiles;
+static int zfiles_order;
+static struct zromfs_cblock zcache[ZROMFS_CACHE_BLOCKS];
+static struct list_head zcache_lru;
+static char *zbuf;                  // compressed data of the block being read
+static volatile int zbusy;          // the cache and "zbuf" are in use
+
+
+/* Decompress an LZ4 block of "srclen" bytes into "dst"
+ *
+ * NOTE
+ * A block is a series of sequences: a token, whose high 4 bits are the # of
+ * literals and low 4 bits the match length - 4, either 15 meaning more bytes
+ * follow, each adding up to 255; the literals; a 2-byte offset back into the
+ * output; the rest of the match length. The last sequence has only literals.
+ * A match may overlap its own output, so it is copied a byte at a time.
+ *
+ * Return value: # of bytes decompressed, or -1 if the data is corrupt
+ */
+static int lz4_decompress(const unsigned char *src, unsigned int srclen,
+				unsigned char *dst, unsigned int dstlen)
+{
+	const unsigned char *ip = src, *iend = src + srclen;
+	unsigned char *op = dst, *oend = dst + dstlen;
+	const unsigned char *match;
+	unsigned int token, len, offset, c;
+
+	while(ip < iend) {
+		token = *ip++;
+
+		/// Literals
+		len = token >> 4;
+		if(len == 15) {
+			do {
+				if(ip >= iend) { return -1; }
+				c = *ip++;
+				len += c;
+			} while(c == 255);
+		}
+		if(len > (unsigned int)(iend - ip) || len > (unsigned int)(oend - op)) {
+			return -1;
+		}
+		memcpy(op, ip, len);
+		op += len;
+		ip += len;
+		if(ip >= iend) {
+			break;
+		}
+
+		/// Match
+		if(iend - ip < 2) {
+			return -1;
+		}
+		offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+		if(offset == 0 || offset > (unsigned int)(op - dst)) {
+			return -1;
+		}
+		len = token & 15;
+		if(len == 15) {
+			do {
+				if(ip >= iend) { return -1; }
+				c = *ip++;
+				len += c;
+			} while(c == 255);
+		}
+		len += 4;
+		if(len > (unsigned int)(oend - op)) {
+			return -1;
+		}
+		for(match = op - offset; len > 0; len--) {
+			*op++ = *match++;
+		}
+	}
+
+	return op - dst;
+}
+
+static void zromfs_lock(void)
+{
+	unsigned int flags;
+
+	flags = local_irq_save();
+	while(zbusy) {
+		local_irq_restore(flags);
+		schedule();
+		flags = local_irq_save();
+	}
+	zbusy = 1;
+	local_irq_restore(flags);
+}
+
+static void zromfs_unlock(void)
+{
+	zbusy = 0;
+}
+
+/* Get block "blocknr" of file "node" decompressed; called with the lock held
+ *
+ * Return value: the cached block, or NULL on error
+ */
+static struct zromfs_cblock *zromfs_get_block(struct inode *node, unsigned int blocknr)
+{
+	struct storage_device *sd = node->super->device;
+	struct zromfs_cblock *cb;
+	struct list_head *pos;
+	unsigned int off[2], raw;
+
+	if(blocknr >= zsb.nr_blocks) {
+		return NULL;
+	}
+
+	list_for_each(pos, &zcache_lru) {
+		cb = list_entry(pos, struct zromfs_cblock, lru);
+		if(cb->valid && cb->blocknr == blocknr) {
+			list_del(&cb->lru);
+			list_add_tail(&cb->lru, &zcache_lru);
+			return cb;
+		}
+	}
+
+	/// Take the least recently used one
+	cb = list_entry(zcache_lru.next, struct zromfs_cblock, lru);
+	list_del(&cb->lru);
+	list_add_tail(&cb->lru, &zcache_lru);
+	cb->valid = 0;
+
+	// Decompressed size: a whole block, except the last block of the file
+	raw = node->dsize - (blocknr - node->daddr) * zsb.block_size;
+	if(raw > zsb.block_size) {
+		raw = zsb.block_size;
+	}
+
+	if(bcache_read(sd, off, ZROMFS_OFFSET + zsb.blocks_off + blocknr*4, sizeof(off))) {
+		return NULL;
+	}
+	if(off[1] < off[0] || off[1] - off[0] > raw || off[1] > zsb.size) {
+		return NULL;
+	}
+
+	if(off[1] - off[0] == raw) {
+		if(bcache_read(sd, cb->data, ZROMFS_OFFSET + off[0], raw)) {
+			return NULL;
+		}
+	} else {
+		if(bcache_read(sd, zbuf, ZROMFS_OFFSET + off[0], off[1] - off[0]) ||
+			lz4_decompress((unsigned char *)zbuf, off[1] - off[0],
+					(unsigned char *)cb->data, raw) != raw) {
+			return NULL;
+		}
+	}
+
+	cb->blocknr = blocknr;
+	cb->valid = 1;
+
+	return cb;
+}
+
+/* Read "size" bytes at offset "pos" of a file */
+int zromfs_read(struct inode *node, void *buf, unsigned int pos, size_t size)
+{
+	struct zromfs_cblock *cb;
+	unsigned int offset, n, done = 0;
+
+	if(pos >= node->dsize) {
+		return 0;
+	}
+	if(size > node->dsize - pos) {
+		size = node->dsize - pos;
+	}
+
+	zromfs_lock();
+	while(done < size) {
+		offset = pos % zsb.block_size;
+		n = zsb.block_size - offset;
+		if(n > size - done) {
+			n = size - done;
+		}
+
+		if((cb = zromfs_get_block(node, node->daddr + pos / zsb.block_size)) == NULL) {
+			zromfs_unlock();
+			return -1;
+		}
+		memcpy((char *)buf + done, cb->data + offset, n);
+
+		pos += n;
+		done += n;
+	}
+	zromfs_unlock();
+
+	return done;
+}
+
+/* Given the path of a file, get its inode
+ *
+ * NOTE
+ * "daddr" of the inode is the # of the file's first block.
+ */
+struct inode *zromfs_namei(struct super_block *super, char *path)
+{
+	struct zromfs_file *zf;
+	struct inode *inode;
+	int lo = 0, hi = zsb.nr_files - 1, mid, cmp;
+
+	while(*path == '/') {
+		path++;
+	}
+
+	while(lo <= hi) {
+		mid = (lo + hi) / 2;
+		zf = &zfiles[mid];
+		if((cmp = strcmp(zf->path, path)) == 0) {
+			if((inode = iget_locked(super, mid)) == NULL) {
+				return NULL;
+			}
+			if(inode->state & I_NEW) {
+				inode->name = zf->path;
+				inode->flags = 0;
+				inode->dsize = zf->size;
+				inode->daddr = zf->first_block;
+				unlock_new_inode(inode);
+			}
+			return inode;
+		}
+		if(cmp < 0) {
+			lo = mid + 1;
+		} else {
+			hi = mid - 1;
+		}
+	}
+
+	return NULL;
+}
+
+// struct "super_block" for zromfs file system
+struct super_block zromfs_super_block = {
+	.namei = zromfs_namei,
+	.read = zromfs_read,
+	.name = "zromfs",
+};
+
+/* Read the super block and the file table of the image
+ *
+ * Return value: 0 on success, -1 if there is no valid image
+ */
+static int zromfs_mount(struct storage_device *sd)
+{
+	unsigned int i, size;
+
+	if(bcache_read(sd, &zsb, ZROMFS_OFFSET, sizeof(zsb)) ||
+		strncmp(zsb.magic, ZROMFS_MAGIC, sizeof(zsb.magic))) {
+		return -1;
+	}
+	if(zsb.block_size == 0 || zsb.block_size > PAGE_SIZE ||
+		(zsb.block_size & (zsb.block_size-1)) ||
+		zsb.size > sd->storage_size - ZROMFS_OFFSET) {
+		return -1;
+	}
+	/// The file table and the nr_blocks+1 entries of the block table must be
+	/// in the image; written so that nothing overflows
+	if(zsb.files_off > zsb.size ||
+		zsb.nr_files > (zsb.size - zsb.files_off) / sizeof(struct zromfs_file) ||
+		zsb.blocks_off > zsb.size ||
+		zsb.nr_blocks >= (zsb.size - zsb.blocks_off) / 4) {
+		return -1;
+	}
+
+	size = zsb.nr_files * sizeof(struct zromfs_file);
+	for(zfiles_order=0; (PAGE_SIZE << zfiles_order) < size; zfiles_order++);
+	if(size && (zfiles = (struct zromfs_file *)get_free_pages(0, zfiles_order)) == NULL) {
+		return -1;
+	}
+	if(size && bcache_read(sd, zfiles, ZROMFS_OFFSET + zsb.files_off, size)) {
+		goto ERR;
+	}
+	for(i=0; i<zsb.nr_files; i++) {
+		zfiles[i].path[ZROMFS_MAX_PATH-1] = '\0';
+	}
+
+	/// Buffers of the decompressed-block cache; a block fits in a page
+	INIT_LIST_HEAD(&zcache_lru);
+	if((zbuf = (char *)get_free_pages(0, 0)) == NULL) {
+		goto ERR;
+	}
+	for(i=0; i<ZROMFS_CACHE_BLOCKS; i++) {
+		if((zcache[i].data = (char *)get_free_pages(0, 0)) == NULL) {
+			goto ERR;
+		}
+		zcache[i].valid = 0;
+		list_add_tail(&zcache[i].lru, &zcache_lru);
+	}
+
+	return 0;
+
+ERR:
+	for(i=0; i<ZROMFS_CACHE_BLOCKS; i++) {
+		if(zcache[i].data) {
+			put_free_pages(zcache[i].data, 0);
+			zcache[i].data = NULL;
+		}
+	}
+	if(zbuf) {
+		put_free_pages(zbuf, 0);
+		zbuf = NULL;
+	}
+	if(zfiles) {
+		put_free_pages(zfiles, zfiles_order);
+		zfiles = NULL;
+	}
+	return -1;
+}
+
+/* Initialize zromfs file system */
+int __init zromfs_init(void)
+{
+	zromfs_super_block.device = storage[RAMDISK];
+
+	if(zromfs_mount(zromfs_super_block.device)) {
+		printk("zromfs: no image found\n");
+		return -1;
+	}
+	printk("zromfs: %d files in %d blocks, %d bytes\n",
+		zsb.nr_files, zsb.nr_blocks, zsb.size);
+	printk("zromfs: cache of %d decompressed blocks\n", ZROMFS_CACHE_BLOCKS);
+
+	return register_file_system(&zromfs_super_block, ZROMFS);
+}
+deferred_initcall(zromfs_init);
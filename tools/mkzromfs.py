@@ -0,0 +1,217 @@
+#!/usr/bin/env python3
+"""mkzromfs.py
+
+Build a zromfs image, the compressed read-only file system of iKernel
+(src/zromfs.c), from a directory tree.
+
+Files are cut into blocks of --block-size bytes, and each block is
+compressed on its own in the LZ4 block format, so the kernel can decompress
+any block without the ones before it. A block that does not get smaller is
+stored as it is.
+
+Image layout; all ints are 32-bit little-endian:
+    super block   "-zrom1fs", block_size, nr_files, nr_blocks,
+                  files_off, blocks_off, size
+    file table    nr_files entries of 64 bytes, sorted by path:
+                  size, first_block, path (56 bytes, NUL-terminated)
+    block table   nr_blocks+1 offsets from the start of the image; block i
+                  takes the bytes from entry i up to entry i+1
+    block data
+
+Usage:
+    tools/mkzromfs.py -d tmp -f zromfs.img
+"""
+
+import argparse
+import os
+import struct
+import sys
+
+MAGIC = b"-zrom1fs"
+SUPER_FMT = "<8s6I"
+FILE_FMT = "<II56s"
+MAX_PATH = 55
+
+# LZ4 block format
+MIN_MATCH = 4
+LAST_LITERALS = 5      # the last 5 bytes are always literals
+MF_LIMIT = 12          # a match does not start within the last 12 bytes
+MAX_OFFSET = 65535
+
+
+def lz4_length(out, n):
+    """Extra bytes of a literal or match length that does not fit in 4 bits"""
+    n -= 15
+    while n >= 255:
+        out.append(255)
+        n -= 255
+    out.append(n)
+
+
+def lz4_sequence(out, literals, offset=0, match_len=0):
+    """Append a sequence; the last one of a block has literals only"""
+    lit_len = len(literals)
+    token = min(lit_len, 15) << 4
+    if match_len:
+        token |= min(match_len - MIN_MATCH, 15)
+    out.append(token)
+    if lit_len >= 15:
+        lz4_length(out, lit_len)
+    out += literals
+    if match_len:
+        out += struct.pack("<H", offset)
+        if match_len - MIN_MATCH >= 15:
+            lz4_length(out, match_len - MIN_MATCH)
+
+
+def lz4_compress(data):
+    """Greedy LZ4 compression of one block, finding matches by a hash table
+    of the last position of every 4-byte string"""
+    n = len(data)
+    out = bytearray()
+    table = {}
+    anchor = i = 0
+    limit = n - MF_LIMIT
+
+    while i < limit:
+        key = data[i:i + MIN_MATCH]
+        cand = table.get(key)
+        table[key] = i
+        if cand is None or i - cand > MAX_OFFSET:
+            i += 1
+            continue
+
+        match_len = MIN_MATCH
+        while i + match_len < n - LAST_LITERALS and \
+                data[cand + match_len] == data[i + match_len]:
+            match_len += 1
+        # Take in the literals before the match that also match
+        while i > anchor and cand > 0 and data[i - 1] == data[cand - 1]:
+            i -= 1
+            cand -= 1
+            match_len += 1
+
+        lz4_sequence(out, data[anchor:i], i - cand, match_len)
+        for j in range(i + 1, min(i + match_len, limit)):
+            table[data[j:j + MIN_MATCH]] = j
+        i += match_len
+        anchor = i
+
+    lz4_sequence(out, data[anchor:])
+    return bytes(out)
+
+
+def lz4_decompress(src, size):
+    """Reference decoder, used to check every compressed block"""
+    out = bytearray()
+    i = 0
+    while i < len(src):
+        token = src[i]
+        i += 1
+        lit_len = token >> 4
+        if lit_len == 15:
+            while True:
+                lit_len += src[i]
+                i += 1
+                if src[i - 1] != 255:
+                    break
+        out += src[i:i + lit_len]
+        i += lit_len
+        if i >= len(src):
+            break
+        offset = src[i] | src[i + 1] << 8
+        i += 2
+        match_len = token & 15
+        if match_len == 15:
+            while True:
+                match_len += src[i]
+                i += 1
+                if src[i - 1] != 255:
+                    break
+        match_len += MIN_MATCH
+        for _ in range(match_len):
+            out.append(out[-offset])
+    if len(out) != size:
+        raise ValueError("bad LZ4 block")
+    return bytes(out)
+
+
+def collect(root):
+    """All regular files under "root", as (path in the image, host path)"""
+    files = []
+    for dirpath, dirnames, filenames in os.walk(root):
+        dirnames.sort()
+        for name in filenames:
+            host = os.path.join(dirpath, name)
+            path = os.path.relpath(host, root).replace(os.sep, "/")
+            if len(path.encode()) > MAX_PATH:
+                sys.exit("mkzromfs: path too long: %s" % path)
+            files.append((path, host))
+    files.sort(key=lambda f: f[0].encode())
+    return files
+
+
+def build(root, block_size):
+    files = collect(root)
+    entries = []
+    blocks = []
+    raw_size = 0
+
+    for path, host in files:
+        with open(host, "rb") as f:
+            data = f.read()
+        raw_size += len(data)
+        entries.append(struct.pack(FILE_FMT, len(data), len(blocks),
+                                   path.encode()))
+        for off in range(0, len(data), block_size):
+            raw = data[off:off + block_size]
+            comp = lz4_compress(raw)
+            if len(comp) < len(raw):
+                assert lz4_decompress(comp, len(raw)) == raw
+                blocks.append(comp)
+            else:
+                blocks.append(raw)
+
+    super_size = struct.calcsize(SUPER_FMT)
+    files_off = super_size
+    blocks_off = files_off + len(entries) * struct.calcsize(FILE_FMT)
+    data_off = blocks_off + (len(blocks) + 1) * 4
+
+    table = []
+    off = data_off
+    for b in blocks:
+        table.append(off)
+        off += len(b)
+    table.append(off)
+
+    image = struct.pack(SUPER_FMT, MAGIC, block_size, len(entries),
+                        len(blocks), files_off, blocks_off, off)
+    image += b"".join(entries)
+    image += struct.pack("<%dI" % len(table), *table)
+    image += b"".join(blocks)
+    return image, len(files), raw_size
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Build a zromfs image")
+    parser.add_argument("-d", "--dir", required=True,
+                        help="directory whose files go into the image")
+    parser.add_argument("-f", "--file", required=True, help="output image")
+    parser.add_argument("-b", "--block-size", type=int, default=4096,
+                        help="bytes per compressed block (power of 2, at "
+                             "most 4096)")
+    args = parser.parse_args()
+
+    bs = args.block_size
+    if bs < 512 or bs > 4096 or bs & (bs - 1):
+        sys.exit("mkzromfs: bad block size %d" % bs)
+
+    image, nr_files, raw_size = build(args.dir, bs)
+    with open(args.file, "wb") as f:
+        f.write(image)
+    print("mkzromfs: %d files, %d bytes -> %d bytes" %
+          (nr_files, raw_size, len(image)))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,196 @@
+#!/usr/bin/env python3
+"""profile.py
+
+Turn the samples dumped by the iKernel profiler (src/profile.c) into a flat
+profile and folded stacks.
+
+The UART log is read from a file or stdin; only the lines between
+"PROFILE BEGIN" and "PROFILE END" are used. Addrs are resolved against the
+function symbols of kernel.elf and the apps given with -e, as listed by nm.
+Each sample carries the load bias of the app run by the sampled process; it is
+subtracted from the addrs that are not in kernel.elf, so the samples of PIE
+apps, which are loaded at a different addr each time, resolve as well.
+
+Usage:
+    tools/profile.py -e src/kernel.elf -e src/app1.elf uart.log
+    tools/profile.py -e src/kernel.elf --folded out.folded uart.log
+    flamegraph.pl out.folded > out.svg
+
+With --hot-lds, the kernel functions that take --hot-cover percent of the
+kernel samples are written, most sampled first, as a linker script fragment
+that kernel.lds includes to place them together (make LAYOUT=hot):
+    tools/profile.py -e src/kernel.elf --hot-lds src/kernel_hot.lds uart.log
+"""
+
+import argparse
+import bisect
+import collections
+import subprocess
+import sys
+
+
+class SymbolTable:
+    """Function symbols of one ELF file, sorted by addr"""
+
+    def __init__(self, path, nm):
+        self.path = path
+        self.addrs = []
+        self.syms = []
+        out = subprocess.run([nm, "-n", "-S", "--defined-only", path],
+                             check=True, capture_output=True, text=True).stdout
+        for line in out.splitlines():
+            fields = line.split()
+            # "addr size type name" or "addr type name" for symbols w/o size
+            if len(fields) == 4:
+                addr, size, kind, name = fields
+                size = int(size, 16)
+            elif len(fields) == 3:
+                addr, kind, name = fields
+                size = 0
+            else:
+                continue
+            if kind not in "tTwW":
+                continue
+            # Skip ARM mapping symbols ($a, $d, $t)
+            if name.startswith("$"):
+                continue
+            self.addrs.append(int(addr, 16))
+            self.syms.append((name, size))
+
+    def lookup(self, addr):
+        i = bisect.bisect_right(self.addrs, addr) - 1
+        if i < 0:
+            return None
+        name, size = self.syms[i]
+        if size and addr >= self.addrs[i] + size:
+            return None
+        # Symbols w/o size cover up to the next symbol only
+        if not size and i + 1 == len(self.addrs):
+            return None
+        return name
+
+
+class Symbolizer:
+    def __init__(self, elfs, nm):
+        self.tables = [SymbolTable(path, nm) for path in elfs]
+        self.cache = {}
+
+    def __call__(self, addr, bias=0):
+        key = (addr, bias)
+        if key not in self.cache:
+            name = self.tables[0].lookup(addr)
+            if not name:
+                # Apps are linked at their addrs less the load bias
+                for table in self.tables[1:]:
+                    name = table.lookup((addr - bias) & 0xffffffff)
+                    if name:
+                        name = "%s:%s" % (table.path.rsplit("/", 1)[-1], name)
+                        break
+            self.cache[key] = name or "0x%08x" % addr
+        return self.cache[key]
+
+
+def read_samples(stream):
+    samples = []
+    inside = False
+    for line in stream:
+        line = line.strip()
+        if line.startswith("PROFILE BEGIN"):
+            inside = True
+            samples = []
+            continue
+        if line.startswith("PROFILE END"):
+            inside = False
+            continue
+        if inside and line.startswith("P "):
+            fields = line.split()
+            # Older dumps have no load bias
+            if len(fields) == 4:
+                fields.append("0")
+            if len(fields) != 5:
+                continue
+            task, pc, lr, bias = (int(x, 16) for x in fields[1:])
+            samples.append((task, pc, lr, bias))
+    return samples
+
+
+def write_hot_lds(path, flat, cover):
+    """Write the kernel functions of "flat" that take "cover" percent of its
+    kernel samples, as input section patterns of kernel.lds"""
+    # Functions of apps have the ELF name prefixed; unresolved addrs are hex
+    kernel = [(name, count) for name, count in flat.most_common()
+              if ":" not in name and not name.startswith("0x")]
+    total = sum(count for _, count in kernel)
+    hot, taken = [], 0
+    for name, count in kernel:
+        if taken * 100.0 >= cover * total:
+            break
+        hot.append(name)
+        taken += count
+    with open(path, "w") as out:
+        out.write("/* kernel_hot.lds\n"
+                  " * Hot functions of the kernel, placed together at the start of .text by\n"
+                  " * kernel.lds in this order; only used by \"make LAYOUT=hot\".\n"
+                  " *\n"
+                  " * NOTE\n"
+                  " * Generated by tools/profile.py --hot-lds: %d functions, %.1f%% of %d\n"
+                  " * kernel samples.\n"
+                  "*/\n\n" % (len(hot), 100.0 * taken / max(total, 1), total))
+        for name in hot:
+            out.write("*(.text.%s)\n" % name)
+    return len(hot)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("log", nargs="?", help="UART log (default: stdin)")
+    parser.add_argument("-e", "--elf", action="append", default=[],
+                        help="ELF file to resolve addrs against; kernel.elf first")
+    parser.add_argument("--nm", default="arm-none-eabi-nm", help="nm to use")
+    parser.add_argument("--folded", help="write folded stacks to this file")
+    parser.add_argument("--top", type=int, default=30, help="# of functions to list")
+    parser.add_argument("--hot-lds", help="write the hot kernel functions to this file")
+    parser.add_argument("--hot-cover", type=float, default=90.0,
+                        help="%% of kernel samples the hot functions take (default: 90)")
+    args = parser.parse_args()
+
+    if not args.elf:
+        parser.error("at least one ELF file is needed")
+
+    stream = open(args.log) if args.log else sys.stdin
+    samples = read_samples(stream)
+    if not samples:
+        sys.exit("no samples found")
+
+    sym = Symbolizer(args.elf, args.nm)
+
+    flat = collections.Counter(sym(pc, bias) for _, pc, _, bias in samples)
+    total = len(samples)
+    print("%d samples" % total)
+    print("%8s %7s  %s" % ("samples", "%", "function"))
+    for name, count in flat.most_common(args.top):
+        print("%8d %6.2f%%  %s" % (count, 100.0 * count / total, name))
+
+    if args.folded:
+        folded = collections.Counter()
+        for task, pc, lr, bias in samples:
+            caller, callee = sym(lr, bias), sym(pc, bias)
+            stack = ["task_%x" % task]
+            # LR is not a return addr in every sample; drop callers that
+            # cannot be resolved
+            if caller != callee and not caller.startswith("0x"):
+                stack.append(caller)
+            stack.append(callee)
+            folded[";".join(stack)] += 1
+        with open(args.folded, "w") as out:
+            for stack, count in sorted(folded.items()):
+                out.write("%s %d\n" % (stack, count))
+
+    if args.hot_lds:
+        n = write_hot_lds(args.hot_lds, flat, args.hot_cover)
+        print("%d hot functions written to %s" % (n, args.hot_lds))
+
+
+if __name__ == "__main__":
+    main()
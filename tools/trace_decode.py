@@ -0,0 +1,132 @@
+#!/usr/bin/env python3
+"""trace_decode.py
+
+Format the events dumped by the iKernel event tracer (src/trace.c).
+
+The UART log is read from a file or stdin; only the lines between
+"TRACE BEGIN" and "TRACE END" are used. Each event holds the addr of its
+format string, which is read from the sections of kernel.elf, and the raw
+argument words, which are formatted here as printk() would.
+
+Usage:
+    tools/trace_decode.py -e src/kernel.elf uart.log
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+SHT_NOBITS = 8
+SHF_ALLOC = 0x2
+
+# printk-style conversions: flags, width, length and type
+SPEC = re.compile(r"%([-0 #+]*)(\d*)(?:hh|h|ll|l|z)?([diuxXopcs%])")
+
+
+class Image:
+    """The loaded sections of an ELF32 little-endian file"""
+
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            data = f.read()
+        if data[:4] != b"\x7fELF" or data[4] != 1 or data[5] != 1:
+            sys.exit("trace_decode: %s is not an ELF32 LSB file" % path)
+        shoff, = struct.unpack_from("<I", data, 32)
+        shentsize, shnum = struct.unpack_from("<HH", data, 46)
+        self.sections = []
+        for i in range(shnum):
+            (_, sh_type, flags, addr, offset, size) = struct.unpack_from(
+                "<IIIIII", data, shoff + i * shentsize)
+            if flags & SHF_ALLOC and sh_type != SHT_NOBITS and size:
+                self.sections.append((addr, data[offset:offset + size]))
+
+    def string(self, addr):
+        """The NUL-terminated string at "addr", or None if not in the file"""
+        for start, body in self.sections:
+            if start <= addr < start + len(body):
+                end = body.find(b"\0", addr - start)
+                if end < 0:
+                    end = len(body)
+                return body[addr - start:end].decode("latin-1")
+        return None
+
+
+def format_event(image, fmt, args):
+    """Format "args" by the printk format "fmt", one word per conversion"""
+    words = iter(args)
+
+    def conv(m):
+        flags, width, kind = m.groups()
+        if kind == "%":
+            return "%"
+        word = next(words, 0)
+        if kind in "di":
+            value = "%d" % (word - (1 << 32) if word & 0x80000000 else word)
+        elif kind == "u":
+            value = "%u" % word
+        elif kind in "xX":
+            value = ("%x" if kind == "x" else "%X") % word
+        elif kind == "o":
+            value = "%o" % word
+        elif kind == "p":
+            value = "0x%08x" % word
+        elif kind == "c":
+            value = chr(word & 0xff)
+        else:
+            value = image.string(word)
+            if value is None:
+                value = "<0x%08x>" % word
+        if width:
+            pad = "0" if "0" in flags and kind not in "cs" else " "
+            if "-" in flags:
+                value = value.ljust(int(width))
+            else:
+                value = value.rjust(int(width), pad)
+        return value
+
+    return SPEC.sub(conv, fmt)
+
+
+def read_events(lines):
+    """Yield (freq, lost, events) of each dump in the log"""
+    events = None
+    for line in lines:
+        line = line.strip()
+        if line.startswith("TRACE BEGIN"):
+            fields = dict(f.split("=") for f in line.split()[2:])
+            freq, lost = int(fields["freq"]), int(fields["lost"])
+            events = []
+        elif line.startswith("TRACE END") and events is not None:
+            yield freq, lost, events
+            events = None
+        elif line.startswith("T ") and events is not None:
+            words = [int(w, 16) for w in line.split()[1:]]
+            if len(words) >= 4:
+                events.append(((words[0] << 32) | words[1], words[2],
+                               words[3], words[4:]))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode a trace dump")
+    parser.add_argument("-e", "--elf", required=True, help="kernel.elf")
+    parser.add_argument("log", nargs="?", help="UART log (default: stdin)")
+    args = parser.parse_args()
+
+    image = Image(args.elf)
+    log = open(args.log, errors="replace") if args.log else sys.stdin
+
+    for freq, lost, events in read_events(log):
+        print("# %d events, %d lost" % (len(events), lost))
+        for cycles, task, fmt_addr, words in events:
+            fmt = image.string(fmt_addr)
+            if fmt is None:
+                text = "<fmt 0x%08x> %s" % (fmt_addr,
+                                           " ".join("%x" % w for w in words))
+            else:
+                text = format_event(image, fmt, words)
+            print("[%12.6f] %08x: %s" % (cycles / freq, task, text))
+
+
+if __name__ == "__main__":
+    main()